@@ -0,0 +1,206 @@
+#include "Bitbase.h"
+#include "movegen.h"
+#include <cstring>
+#include <fstream>
+
+
+namespace {
+    enum Outcome : uint8_t {Invalid, Unknown, Drawn, Won};
+
+    // The strong side is always white here, so pawns move up the board
+    struct Position {
+        bool strongToMove;
+        int strongKing, weakKing, piece;
+    };
+
+    Position Decode(int index) {
+        return {(index & 1) == 0, (index >> 1) & 63, (index >> 7) & 63, (index >> 13) & 63};
+    }
+
+    int Encode(bool strongToMove, int strongKing, int weakKing, int piece) {
+        return (strongToMove ? 0 : 1) | strongKing << 1 | weakKing << 7 | piece << 13;
+    }
+
+    U64 PieceAttacks(int pieceType, int square, U64 occupancy) {
+        switch (pieceType) {
+            case 1:
+                return PawnMoves::allCaptures(true, 1ULL << square);
+            case 4:
+                return RookAttacks(square, occupancy);
+            default:
+                return RookAttacks(square, occupancy) | BishopAttacks(square, occupancy);
+        }
+    }
+
+    Outcome Initial(const Position& position, int pieceType) {
+        const U64 strongKing = 1ULL << position.strongKing;
+        const U64 weakKing = 1ULL << position.weakKing;
+        const U64 piece = 1ULL << position.piece;
+
+        if (position.strongKing == position.weakKing || position.strongKing == position.piece ||
+            position.weakKing == position.piece) {
+            return Invalid;
+        }
+        if (MovementTables::kingMoves[position.strongKing] & weakKing) return Invalid;
+        if (pieceType == 1 && (piece & (Board::Ranks::rank_1 | Board::Ranks::rank_8))) return Invalid;
+
+        bool inCheck = PieceAttacks(pieceType, position.piece, strongKing | weakKing) & weakKing;
+        if (position.strongToMove) {
+            if (inCheck) return Invalid;
+
+            // A pawn that promotes without being taken wins
+            if (pieceType == 1 && (piece & Board::Ranks::rank_7)) {
+                U64 promotion = piece << 8;
+                if (!(promotion & (strongKing | weakKing)) &&
+                    (!(MovementTables::kingMoves[position.weakKing] & promotion) ||
+                     (MovementTables::kingMoves[position.strongKing] & promotion))) {
+                    return Won;
+                }
+            }
+            return Unknown;
+        }
+
+        // Sliders see through the weak king, it can't step back along the line of attack
+        U64 guarded = MovementTables::kingMoves[position.strongKing] | PieceAttacks(pieceType, position.piece, strongKing);
+        U64 escapes = MovementTables::kingMoves[position.weakKing] & ~guarded;
+
+        if (!escapes) return inCheck ? Won : Drawn;
+        if (escapes & piece) return Drawn; // the lone piece falls
+        return Unknown;
+    }
+
+    Outcome Successors(const Position& position, int pieceType, const std::vector<Outcome>& results) {
+        const U64 strongKing = 1ULL << position.strongKing;
+        const U64 weakKing = 1ULL << position.weakKing;
+        const U64 piece = 1ULL << position.piece;
+        bool sawUnknown = false;
+
+        if (position.strongToMove) {
+            auto visit = [&](int strongKingSquare, int pieceSquare) {
+                Outcome outcome = results[Encode(false, strongKingSquare, position.weakKing, pieceSquare)];
+                if (outcome == Unknown) sawUnknown = true;
+                return outcome == Won;
+            };
+
+            U64 kingMoves = MovementTables::kingMoves[position.strongKing] &
+                            ~MovementTables::kingMoves[position.weakKing] & ~piece;
+            while (kingMoves) {
+                if (visit(popLSB(kingMoves), position.piece)) return Won;
+            }
+
+            U64 pieceMoves;
+            if (pieceType == 1) {
+                // Promotions were settled when the table was initialised
+                U64 push = position.piece < Board::Squares::a7 ? piece << 8 & ~(strongKing | weakKing) : 0;
+                U64 doublePush = (push & Board::Ranks::rank_3) << 8 & ~(strongKing | weakKing);
+                pieceMoves = push | doublePush;
+            } else {
+                pieceMoves = PieceAttacks(pieceType, position.piece, strongKing | weakKing) & ~(strongKing | weakKing);
+            }
+            while (pieceMoves) {
+                if (visit(position.strongKing, popLSB(pieceMoves))) return Won;
+            }
+            return sawUnknown ? Unknown : Drawn;
+        }
+
+        U64 guarded = MovementTables::kingMoves[position.strongKing] | PieceAttacks(pieceType, position.piece, strongKing);
+        U64 escapes = MovementTables::kingMoves[position.weakKing] & ~guarded;
+        while (escapes) {
+            Outcome outcome = results[Encode(true, position.strongKing, popLSB(escapes), position.piece)];
+            if (outcome == Drawn) return Drawn;
+            if (outcome == Unknown) sawUnknown = true;
+        }
+        return sawUnknown ? Unknown : Won;
+    }
+
+    const char cacheMagic[4] = {'C', 'E', 'B', 'B'};
+    const uint32_t cacheVersion = 1;
+}
+
+void Bitbases::Init(const std::string& cachePath) {
+    if (ready) return;
+
+    if (!Load(cachePath)) {
+        for (int table = 0; table < TableCount; ++table) Generate(static_cast<Table>(table));
+        Save(cachePath);
+    }
+    ready = true;
+}
+
+void Bitbases::Generate(Table table) {
+    const int pieceTypes[TableCount] = {1, 4, 5};
+    int pieceType = pieceTypes[table];
+
+    std::vector<Outcome> results(positionCount);
+    for (int index = 0; index < positionCount; ++index) {
+        results[index] = Initial(Decode(index), pieceType);
+    }
+
+    // Keep passing over the unresolved positions until a pass settles nothing new
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int index = 0; index < positionCount; ++index) {
+            if (results[index] != Unknown) continue;
+
+            results[index] = Successors(Decode(index), pieceType, results);
+            changed |= results[index] != Unknown;
+        }
+    }
+
+    // Whatever the strong side still couldn't force is a draw
+    tables[table].assign(positionCount / 64, 0);
+    for (int index = 0; index < positionCount; ++index) {
+        if (results[index] == Won) tables[table][index / 64] |= 1ULL << (index % 64);
+    }
+}
+
+bool Bitbases::Load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[4];
+    uint32_t version;
+    if (!file.read(magic, 4) || std::memcmp(magic, cacheMagic, 4) != 0) return false;
+    if (!file.read(reinterpret_cast<char*>(&version), sizeof(version)) || version != cacheVersion) return false;
+
+    for (auto& table : tables) {
+        table.resize(positionCount / 64);
+        if (!file.read(reinterpret_cast<char*>(table.data()), table.size() * sizeof(uint64_t))) return false;
+    }
+    return true;
+}
+
+void Bitbases::Save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return;
+
+    file.write(cacheMagic, 4);
+    file.write(reinterpret_cast<const char*>(&cacheVersion), sizeof(cacheVersion));
+    for (const auto& table : tables) {
+        file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(uint64_t));
+    }
+}
+
+bool Bitbases::Probe(const Gamestate& gamestate, int& result) const {
+    if (!ready || bit_cnt(gamestate.all_pieces) != 3) return false;
+
+    Table table;
+    U64 pieces = gamestate.all_pieces & ~(gamestate.w_king | gamestate.b_king);
+    if (pieces & (gamestate.w_pawn | gamestate.b_pawn)) table = KPK;
+    else if (pieces & (gamestate.w_rook | gamestate.b_rook)) table = KRK;
+    else if (pieces & (gamestate.w_queen | gamestate.b_queen)) table = KQK;
+    else return false;
+
+    // Mirror the board when black is the strong side, so the strong side is white
+    bool strongIsWhite = pieces & gamestate.w_pieces;
+    int flip = strongIsWhite ? 0 : 56;
+    int strongKing = squareOf(strongIsWhite ? gamestate.w_king : gamestate.b_king) ^ flip;
+    int weakKing = squareOf(strongIsWhite ? gamestate.b_king : gamestate.w_king) ^ flip;
+    int piece = squareOf(pieces) ^ flip;
+    bool strongToMove = gamestate.whiteToMove == strongIsWhite;
+
+    int index = Encode(strongToMove, strongKing, weakKing, piece);
+    bool win = tables[table][index / 64] >> (index % 64) & 1;
+
+    result = win ? (strongToMove ? 1 : -1) : 0;
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef CHESS_ENGINE_BITBASE_H
+#define CHESS_ENGINE_BITBASE_H
+
+#include "gamestate.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Win/draw tables for king and pawn, rook or queen against a lone king, one bit per position.
+// They are built by retrograde analysis, which takes a moment, so the result is cached on disk.
+class Bitbases {
+private:
+    Bitbases() = default;
+
+    enum Table {KPK, KRK, KQK, TableCount};
+
+    // Strong side's king, weak side's king, the extra piece and whose move it is
+    static const int positionCount = 2 * 64 * 64 * 64;
+
+    void Generate(Table table);
+    bool Load(const std::string& path);
+    void Save(const std::string& path) const;
+
+    std::array<std::vector<uint64_t>, TableCount> tables;
+    bool ready = false;
+
+public:
+    static Bitbases& Get() {
+        static Bitbases instance;
+        return instance;
+    }
+
+    Bitbases(const Bitbases&) = delete;
+
+    // Must run before any search probes the tables
+    void Init(const std::string& cachePath);
+
+    // True for a covered position. Result is then 1 when the side to move wins,
+    // -1 when it loses and 0 for a draw.
+    bool Probe(const Gamestate& gamestate, int& result) const;
+};
+
+
+#endif //CHESS_ENGINE_BITBASE_H
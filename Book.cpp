@@ -0,0 +1,149 @@
+#include "Book.h"
+#include "movegen.h"
+#include "PolyglotRandom.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace {
+    const int castleOffset = 768;
+    const int enPassantOffset = 772;
+    const int turnOffset = 780;
+    const size_t entrySize = 16;
+
+    U64 ReadBigEndian(const unsigned char* bytes, int count) {
+        U64 value = 0;
+        for (int i = 0; i < count; ++i) value = value << 8 | bytes[i];
+        return value;
+    }
+}
+
+OpeningBook::OpeningBook() : generator(std::random_device()()) {}
+
+OpeningBook::~OpeningBook() {
+    Close();
+}
+
+bool OpeningBook::Open(const std::string& path) {
+    Close();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat fileInfo;
+    if (fstat(fd, &fileInfo) != 0 || fileInfo.st_size < static_cast<off_t>(entrySize)) {
+        close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, fileInfo.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the file alive
+    if (mapping == MAP_FAILED) return false;
+
+    madvise(mapping, fileInfo.st_size, MADV_RANDOM);
+    data = static_cast<const unsigned char*>(mapping);
+    mappedSize = fileInfo.st_size;
+    entryCount = mappedSize / entrySize;
+    return true;
+}
+
+void OpeningBook::Close() {
+    if (data) munmap(const_cast<unsigned char*>(data), mappedSize);
+    data = nullptr;
+    mappedSize = entryCount = 0;
+}
+
+OpeningBook::Entry OpeningBook::ReadEntry(size_t index) const {
+    const unsigned char* bytes = data + index * entrySize;
+    return {ReadBigEndian(bytes, 8),
+            static_cast<uint16_t>(ReadBigEndian(bytes + 8, 2)),
+            static_cast<uint16_t>(ReadBigEndian(bytes + 10, 2)),
+            static_cast<uint32_t>(ReadBigEndian(bytes + 12, 4))};
+}
+
+size_t OpeningBook::LowerBound(U64 key) const {
+    size_t low = 0, high = entryCount;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (ReadBigEndian(data + middle * entrySize, 8) < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+U64 OpeningBook::PolyglotKey(const Gamestate& gamestate) const {
+    U64 key = 0;
+
+    for (int square = 0; square < 64; ++square) {
+        int piece = gamestate.mailbox[square];
+        if (!piece) continue;
+
+        // Polyglot orders pieces black pawn, white pawn, black knight, ...
+        int kind = 2 * ((piece & 0b0111) - 1) + (piece & 0b1000 ? 0 : 1);
+        key ^= Polyglot::random64[64 * kind + square];
+    }
+
+    if (gamestate.legality & legalityBits::whiteShortCastleMask) key ^= Polyglot::random64[castleOffset];
+    if (gamestate.legality & legalityBits::whiteLongCastleMask) key ^= Polyglot::random64[castleOffset + 1];
+    if (gamestate.legality & legalityBits::blackShortCastleMask) key ^= Polyglot::random64[castleOffset + 2];
+    if (gamestate.legality & legalityBits::blackLongCastleMask) key ^= Polyglot::random64[castleOffset + 3];
+
+    // The en passant file only counts when a pawn can actually make the capture
+    if (gamestate.legality & legalityBits::enPassantLegalMask) {
+        int file = (gamestate.legality & legalityBits::enPassantFileMask) >> legalityBits::enPassantFileShift;
+        U64 adjacent = (file > 0 ? Board::Files::aFile << (file - 1) : 0) | (file < 7 ? Board::Files::aFile << (file + 1) : 0);
+        U64 capturers = gamestate.whiteToMove ? gamestate.w_pawn & Board::Ranks::rank_5 : gamestate.b_pawn & Board::Ranks::rank_4;
+        if (capturers & adjacent) key ^= Polyglot::random64[enPassantOffset + file];
+    }
+
+    if (gamestate.whiteToMove) key ^= Polyglot::random64[turnOffset];
+    return key;
+}
+
+uint16_t OpeningBook::EncodeMove(Move move) {
+    int endSquare = move.endSquare;
+
+    // Polyglot writes castling as the king capturing its own rook
+    if (move.flag == MoveFlags::shortCastle) endSquare = move.endSquare + 1;
+    if (move.flag == MoveFlags::longCastle) endSquare = move.endSquare - 2;
+
+    int promotion = move.flag >= MoveFlags::knightPromotion ? (move.flag & 0b11) + 1 : 0;
+    return static_cast<uint16_t>(promotion << 12 | move.startSquare << 6 | endSquare);
+}
+
+bool OpeningBook::PickMove(Move& move) {
+    if (!IsOpen()) return false;
+
+    Gamestate& gamestate = Gamestate::Get();
+    U64 key = PolyglotKey(gamestate);
+    std::vector<Move> legalMoves = MoveGenerator::Get().GenerateLegalMoves();
+
+    std::vector<Move> candidates;
+    std::vector<int> weights;
+    for (size_t index = LowerBound(key); index < entryCount; ++index) {
+        Entry entry = ReadEntry(index);
+        if (entry.key != key) break;
+
+        // Entries from a corrupt or foreign book may not be legal here
+        for (Move legalMove : legalMoves) {
+            if (EncodeMove(legalMove) == entry.move) {
+                candidates.push_back(legalMove);
+                weights.push_back(entry.weight);
+                break;
+            }
+        }
+    }
+
+    int totalWeight = 0;
+    for (int weight : weights) totalWeight += weight;
+    if (totalWeight == 0) return false;
+
+    std::discrete_distribution<size_t> distribution(weights.begin(), weights.end());
+    move = candidates[distribution(generator)];
+    return true;
+}
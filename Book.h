@@ -9,31 +9,51 @@
 #include "gamestate.h"
 #include <string>
 #include <array>
+#include <cstdint>
+#include <random>
 #include <vector>
 
+// Reads opening books in the Polyglot .bin format: 16 byte big endian entries
+// (key, move, weight, learn) sorted by key. The file is memory mapped, so even
+// very large books open instantly and only the pages a lookup touches are read.
 class OpeningBook {
 private:
     OpeningBook();
+    ~OpeningBook();
 
-    struct Node {
-        std::string move;
-        int playCount;
-        std::vector<Node> children;
+    struct Entry {
+        U64 key;
+        uint16_t move;
+        uint16_t weight;
+        uint32_t learn;
     };
 
-    std::vector<Node> data;
+    Entry ReadEntry(size_t index) const;
+    size_t LowerBound(U64 key) const;
+
+    const unsigned char* data = nullptr;
+    size_t mappedSize = 0;
+    size_t entryCount = 0;
+
+    std::mt19937 generator;
 
 public:
-    OpeningBook& Get() {
+    static OpeningBook& Get() {
         static OpeningBook instance;
         return instance;
     }
 
-    bool inOpeningBook = true;
+    OpeningBook(const OpeningBook&) = delete;
 
-    void playBookMove() {
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return data != nullptr; }
 
-    }
+    U64 PolyglotKey(const Gamestate& gamestate) const;
+    static uint16_t EncodeMove(Move move);
+
+    // Picks one of the book moves for the current position, weighted by the entries' weights
+    bool PickMove(Move& move);
 };
 
 #endif //CHESS_ENGINE_BOOK_H
@@ -4,9 +4,9 @@
 
 #include "Bot.h"
 #include "Search.h"
-#include "Transposition.h"
-#include "gamestate.h"
-#include "evaluation.h"
+#include "Book.h"
+#include "SearchThread.h"
+#include "Zobrist.h"
 #include "GUI/gui.h"
 
 
@@ -15,13 +15,120 @@ Bot::Bot() {
 }
 
 void Bot::PlayMove() {
-    if (!bot_to_play || Gamestate::Get().whiteToMove != playing_white and false) return;
-    Evaluator::Get().callCount = 0;
-    MovePicker::Get().InitSearch();
-    call_count += Evaluator::Get().callCount;
-    total_time += 1;
-    //std::cout << (call_count / total_time) << std:: endl;
-    std::cout << PGNNotation(MovePicker::Get().bestMove) << ", ";
-    Gamestate::Get().MakeMove(MovePicker::Get().bestMove);
+    if (!bot_to_play || Gamestate::Get().result != Pending) return;
+
+    U64 key = Zobrist::Get().GenerateKey();
+
+    if (pondering) {
+        if (!BotToMove()) return; // the opponent is still thinking
+        pondering = false;
+
+        if (key == search_key) {
+            // The predicted reply was played, the ponder search becomes the real one
+            SearchThread::Get().PonderHit();
+        } else {
+            CancelSearch();
+        }
+    }
+
+    if (!BotToMove()) return;
+
+    if (searching && key != search_key) {
+        // The position changed under the search (e.g. the user moved for us), so search again
+        CancelSearch();
+    }
+
+    if (!searching) {
+        if (use_book && PlayBookMove()) return;
+        StartSearch();
+        return;
+    }
+
+    SearchResult result;
+    if (!SearchThread::Get().Poll(result)) return;
+    searching = false;
+
+    if (result.id != search_id) return;
+
+    int& clock = Gamestate::Get().whiteToMove ? white_time : black_time;
+    clock += increment - result.elapsed;
+
+    std::cout << PGNNotation(result.bestMove) << ", ";
+    Gamestate::Get().MakeMove(result.bestMove);
+    GUI::Get().UpdateHighlights();
+
+    if (ponder && !BotToMove() && result.ponderMove.flag != MoveFlags::nullMove) {
+        StartPondering(result.ponderMove);
+    }
+}
+
+bool Bot::PlayBookMove() {
+    // Book moves are instant, the clock only gains the increment
+    Move move;
+    if (!OpeningBook::Get().PickMove(move)) return false;
+
+    int& clock = Gamestate::Get().whiteToMove ? white_time : black_time;
+    clock += increment;
+
+    std::cout << PGNNotation(move) << ", ";
+    Gamestate::Get().MakeMove(move);
     GUI::Get().UpdateHighlights();
-}
\ No newline at end of file
+    return true;
+}
+
+void Bot::StartSearch() {
+    Gamestate& gamestate = Gamestate::Get();
+
+    SearchRequest request;
+    request.position = gamestate.startingPosition;
+    request.moves = gamestate.MoveHistory();
+    request.limits.timeLeft = gamestate.whiteToMove ? white_time : black_time;
+    request.limits.increment = increment;
+    request.limits.movesToGo = moves_to_go;
+
+    search_key = Zobrist::Get().GenerateKey();
+    search_id = SearchThread::Get().Submit(request);
+    searching = true;
+}
+
+void Bot::StartPondering(Move predictedMove) {
+    Gamestate& gamestate = Gamestate::Get();
+
+    // Search the position after the expected reply, on the clock we will have then
+    SearchRequest request;
+    request.position = gamestate.startingPosition;
+    request.moves = gamestate.MoveHistory();
+    request.moves.push_back(predictedMove);
+    request.limits.timeLeft = gamestate.whiteToMove ? black_time : white_time;
+    request.limits.increment = increment;
+    request.limits.movesToGo = moves_to_go;
+    request.limits.ponder = true;
+
+    gamestate.MakeMove(predictedMove);
+    search_key = Zobrist::Get().GenerateKey();
+    gamestate.UndoMove();
+
+    search_id = SearchThread::Get().Submit(request);
+    searching = pondering = true;
+}
+
+bool Bot::BotToMove() {
+    return Gamestate::Get().whiteToMove ? playing_white : playing_black;
+}
+
+void Bot::MoveNow() {
+    if (searching) SearchThread::Get().Stop();
+}
+
+void Bot::CancelSearch() {
+    if (!searching) return;
+    SearchThread::Get().Cancel();
+    searching = pondering = false;
+}
+
+void Bot::Resign() {
+    // Mid-search the bot is the side to move, otherwise the user is resigning on their own move
+    bool whiteWins = Gamestate::Get().whiteToMove == (searching && !pondering);
+    CancelSearch();
+    Gamestate::Get().result = whiteWins ? WhiteWin : BlackWin;
+}
@@ -5,11 +5,23 @@
 #ifndef CHESS_ENGINE_BOT_H
 #define CHESS_ENGINE_BOT_H
 
+#include "gamestate.h"
+
 
 class Bot {
 private:
     Bot();
 
+    bool PlayBookMove();
+    void StartSearch();
+    void StartPondering(Move predictedMove);
+    bool BotToMove();
+
+    bool searching = false;
+    bool pondering = false;
+    int search_id = 0;
+    U64 search_key = 0;
+
 public:
     static Bot& Get() {
         static Bot instance;
@@ -19,11 +31,18 @@ public:
     bool bot_to_play = true;
     bool playing_white = true;
     bool playing_black = true;
+    bool ponder = true;
+    bool use_book = true;
 
-    float call_count;
-    float total_time;
+    int white_time = 300000; // ms
+    int black_time = 300000; // ms
+    int increment = 2000;    // ms
+    int moves_to_go = 0;
 
     void PlayMove();
+    void MoveNow();
+    void CancelSearch();
+    void Resign();
 };
 
 
@@ -0,0 +1,43 @@
+#include "EvalCache.h"
+#include <cstdint>
+
+
+EvalCache::EvalCache() : slots(tableSize) {
+    Clear();
+}
+
+bool EvalCache::Probe(U64 key, int& score) {
+    probes.fetch_add(1, std::memory_order_relaxed);
+
+    U64 slot = slots[key & (tableSize - 1)].load(std::memory_order_relaxed);
+    if ((slot & ~scoreMask) != (key & ~scoreMask) || slot == 0) return false;
+
+    hits.fetch_add(1, std::memory_order_relaxed);
+    score = static_cast<int16_t>(slot & scoreMask);
+    return true;
+}
+
+void EvalCache::Store(U64 key, int score) {
+    // Scores that don't fit in 16 bits are simply not cached
+    if (score < INT16_MIN || score > INT16_MAX) return;
+
+    U64 slot = (key & ~scoreMask) | static_cast<uint16_t>(score);
+    slots[key & (tableSize - 1)].store(slot, std::memory_order_relaxed);
+}
+
+void EvalCache::Clear() {
+    for (auto& slot : slots) {
+        slot.store(0, std::memory_order_relaxed);
+    }
+    ResetStats();
+}
+
+double EvalCache::HitRate() const {
+    U64 total = Probes();
+    return total ? static_cast<double>(Hits()) / total : 0;
+}
+
+void EvalCache::ResetStats() {
+    probes.store(0, std::memory_order_relaxed);
+    hits.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,43 @@
+#ifndef CHESS_ENGINE_EVALCACHE_H
+#define CHESS_ENGINE_EVALCACHE_H
+
+#include "gamestate.h"
+#include <atomic>
+#include <vector>
+
+
+// Shared by every search thread without locking. Each slot packs the upper 48 bits
+// of the key with a 16 bit score into one word, so a torn read can't pair a key
+// with another position's score.
+class EvalCache {
+private:
+    EvalCache();
+
+    static const int tableSize = 1 << 18; // must be a power of two
+    static const U64 scoreMask = 0xFFFF;
+
+    std::vector<std::atomic<U64>> slots;
+
+    std::atomic<U64> probes = 0;
+    std::atomic<U64> hits = 0;
+
+public:
+    static EvalCache& Get() {
+        static EvalCache instance;
+        return instance;
+    }
+
+    EvalCache(const EvalCache&) = delete;
+
+    bool Probe(U64 key, int& score);
+    void Store(U64 key, int score);
+    void Clear();
+
+    U64 Probes() const { return probes.load(std::memory_order_relaxed); }
+    U64 Hits() const { return hits.load(std::memory_order_relaxed); }
+    double HitRate() const;
+    void ResetStats();
+};
+
+
+#endif //CHESS_ENGINE_EVALCACHE_H
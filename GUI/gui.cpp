@@ -342,6 +342,7 @@ void GUI::HandleKeyPress(SDL_Keycode key) {
     switch (key) {
         case SDLK_LEFT:
             if (!gamestate.moveLog.empty()) {
+                Bot::Get().CancelSearch();
                 gamestate.UndoMove();
                 UpdateHighlights();
                 moveIndicatorSqs.clear();
@@ -352,6 +353,7 @@ void GUI::HandleKeyPress(SDL_Keycode key) {
 
         case SDLK_RIGHT:
             if (!backupMoveLog.empty()) {
+                Bot::Get().CancelSearch();
                 gamestate.MakeMove(backupMoveLog.top());
                 backupMoveLog.pop();
                 highlightedSqs = {gamestate.moveLog.top().startSquare, gamestate.moveLog.top().endSquare};
@@ -363,6 +365,20 @@ void GUI::HandleKeyPress(SDL_Keycode key) {
 
         case SDLK_f:
             GUI::Get().flipBoard = !GUI::Get().flipBoard;
+            break;
+
+        case SDLK_SPACE:
+            Bot::Get().MoveNow();
+            break;
+
+        case SDLK_ESCAPE:
+            Bot::Get().CancelSearch();
+            Bot::Get().bot_to_play = false;
+            break;
+
+        case SDLK_r:
+            Bot::Get().Resign();
+            break;
 
         default:
             break;
@@ -0,0 +1,256 @@
+#include "NNUE.h"
+#include "movegen.h"
+#include "EvalCache.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+using namespace NNUEArch;
+
+
+namespace {
+    template <typename T>
+    bool ReadArray(std::ifstream& file, T* values, size_t count) {
+        file.read(reinterpret_cast<char*>(values), static_cast<std::streamsize>(count * sizeof(T)));
+        return static_cast<bool>(file);
+    }
+
+    void AddColumn(int16_t* accumulator, const int16_t* column) {
+#if defined(__AVX2__)
+        for (int i = 0; i < halfDimensions; i += 16) {
+            __m256i values = _mm256_load_si256(reinterpret_cast<const __m256i*>(accumulator + i));
+            __m256i weights = _mm256_load_si256(reinterpret_cast<const __m256i*>(column + i));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(accumulator + i), _mm256_add_epi16(values, weights));
+        }
+#else
+        for (int i = 0; i < halfDimensions; ++i) accumulator[i] += column[i];
+#endif
+    }
+
+    void SubColumn(int16_t* accumulator, const int16_t* column) {
+#if defined(__AVX2__)
+        for (int i = 0; i < halfDimensions; i += 16) {
+            __m256i values = _mm256_load_si256(reinterpret_cast<const __m256i*>(accumulator + i));
+            __m256i weights = _mm256_load_si256(reinterpret_cast<const __m256i*>(column + i));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(accumulator + i), _mm256_sub_epi16(values, weights));
+        }
+#else
+        for (int i = 0; i < halfDimensions; ++i) accumulator[i] -= column[i];
+#endif
+    }
+
+    // Clamps one half of the accumulator into [0, 127]
+    void ClipAccumulator(const int16_t* accumulator, uint8_t* output) {
+#if defined(__AVX2__)
+        const __m256i zero = _mm256_setzero_si256();
+        for (int i = 0; i < halfDimensions; i += 32) {
+            __m256i low = _mm256_load_si256(reinterpret_cast<const __m256i*>(accumulator + i));
+            __m256i high = _mm256_load_si256(reinterpret_cast<const __m256i*>(accumulator + i + 16));
+            // packs saturates to 127 but interleaves the 128 bit lanes, the permute undoes that
+            __m256i packed = _mm256_max_epi8(_mm256_packs_epi16(low, high), zero);
+            packed = _mm256_permute4x64_epi64(packed, 0b11011000);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(output + i), packed);
+        }
+#else
+        for (int i = 0; i < halfDimensions; ++i) {
+            output[i] = static_cast<uint8_t>(std::clamp<int>(accumulator[i], 0, maxActivation));
+        }
+#endif
+    }
+
+    // size must be a multiple of 32 and both arrays 32 byte aligned
+    int32_t DotProduct(const uint8_t* input, const int8_t* weights, int size) {
+#if defined(__AVX2__)
+        const __m256i ones = _mm256_set1_epi16(1);
+        __m256i sum = _mm256_setzero_si256();
+        for (int i = 0; i < size; i += 32) {
+            __m256i in = _mm256_load_si256(reinterpret_cast<const __m256i*>(input + i));
+            __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(weights + i));
+            // Inputs are at most 127, so the pairwise int16 sums can't saturate
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(in, w), ones));
+        }
+        __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0b01001110));
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0b10110001));
+        return _mm_cvtsi128_si32(total);
+#else
+        int32_t sum = 0;
+        for (int i = 0; i < size; ++i) sum += input[i] * weights[i];
+        return sum;
+#endif
+    }
+
+    template <int Inputs, int Outputs>
+    void DenseClipped(const uint8_t* input, const int8_t* weights, const int32_t* biases, uint8_t* output) {
+        for (int i = 0; i < Outputs; ++i) {
+            int32_t sum = biases[i] + DotProduct(input, weights + i * Inputs, Inputs);
+            output[i] = static_cast<uint8_t>(std::clamp(sum >> weightShift, 0, maxActivation));
+        }
+    }
+}
+
+bool NNUENetwork::Load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    char magic[4];
+    uint32_t header[5];
+    if (!ReadArray(file, magic, 4) || std::memcmp(magic, "CENN", 4) != 0) return false;
+    if (!ReadArray(file, header, 5)) return false;
+    const uint32_t expected[5] = {1, featureCount, halfDimensions, hidden1, hidden2};
+    if (!std::equal(header, header + 5, expected)) {
+        return false;
+    }
+
+    auto loaded = std::make_unique<Weights>();
+    bool ok = ReadArray(file, loaded->featureBiases, halfDimensions) &&
+              ReadArray(file, loaded->featureWeights, static_cast<size_t>(featureCount) * halfDimensions) &&
+              ReadArray(file, loaded->hidden1Biases, hidden1) &&
+              ReadArray(file, loaded->hidden1Weights, hidden1 * 2 * halfDimensions) &&
+              ReadArray(file, loaded->hidden2Biases, hidden2) &&
+              ReadArray(file, loaded->hidden2Weights, hidden2 * hidden1) &&
+              ReadArray(file, &loaded->outputBias, 1) &&
+              ReadArray(file, loaded->outputWeights, hidden2);
+    if (!ok) return false;
+
+    weights = std::move(loaded);
+    // Cached scores came from the hand written evaluation
+    EvalCache::Get().Clear();
+    return true;
+}
+
+void NNUE::Reset() {
+    active = NNUENetwork::Get().IsLoaded();
+    ply = 0;
+    if (stack.empty()) stack.resize(256);
+    stack[0].computed[0] = stack[0].computed[1] = false;
+    stack[0].dirty = DirtyPieces();
+}
+
+void NNUE::Push(Move move, const Gamestate& gamestate) {
+    if (++ply == static_cast<int>(stack.size())) stack.resize(2 * stack.size());
+
+    Accumulator& accumulator = stack[ply];
+    accumulator.computed[0] = accumulator.computed[1] = false;
+    DirtyPieces& dirty = accumulator.dirty;
+    dirty = DirtyPieces();
+    if (move.flag == MoveFlags::nullMove) return;
+
+    auto change = [&dirty](int piece, int square, bool added) {
+        if ((piece & 0b0111) == 6) {
+            dirty.kingMoved[piece >> 3] = true;
+            return;
+        }
+        dirty.piece[dirty.count] = piece;
+        dirty.square[dirty.count] = square;
+        dirty.added[dirty.count] = added;
+        ++dirty.count;
+    };
+
+    int movingPiece = gamestate.mailbox[move.startSquare];
+    int capturedPiece = gamestate.mailbox[move.endSquare];
+    int placedPiece = (move.flag & MoveFlags::promotion) ? movingPiece + (move.flag & 0b11) + 1 : movingPiece;
+
+    if (capturedPiece) change(capturedPiece, move.endSquare, false);
+    change(movingPiece, move.startSquare, false);
+    change(placedPiece, move.endSquare, true);
+
+    switch (move.flag) {
+        case MoveFlags::enPassant:
+            change(movingPiece ^ 0b1000, 8 * (move.startSquare / 8) + move.endSquare % 8, false);
+            break;
+        case MoveFlags::shortCastle:
+            change(movingPiece - 2, move.endSquare + 1, false);
+            change(movingPiece - 2, move.startSquare + 1, true);
+            break;
+        case MoveFlags::longCastle:
+            change(movingPiece - 2, move.endSquare - 2, false);
+            change(movingPiece - 2, move.startSquare - 1, true);
+            break;
+    }
+}
+
+void NNUE::Pop() {
+    if (ply > 0) --ply;
+}
+
+int NNUE::FeatureIndex(int perspective, int kingSquare, int piece, int square) {
+    // Black sees the board flipped, so both sides share one set of weights
+    int orientation = perspective == 0 ? 0 : 56;
+    int pieceIndex = (piece & 0b0111) - 1 + ((piece >> 3) == perspective ? 0 : 5);
+    return ((kingSquare ^ orientation) * 10 + pieceIndex) * 64 + (square ^ orientation);
+}
+
+void NNUE::Refresh(Accumulator& accumulator, int perspective) {
+    const Gamestate& gamestate = Gamestate::Get();
+    const NNUENetwork::Weights& weights = *NNUENetwork::Get().weights;
+    int kingSquare = squareOf(perspective == 0 ? gamestate.w_king : gamestate.b_king);
+
+    std::memcpy(accumulator.values[perspective], weights.featureBiases, sizeof(weights.featureBiases));
+    for (int square = 0; square < 64; ++square) {
+        int piece = gamestate.mailbox[square];
+        if (!piece || (piece & 0b0111) == 6) continue;
+
+        int feature = FeatureIndex(perspective, kingSquare, piece, square);
+        AddColumn(accumulator.values[perspective], weights.featureWeights + feature * halfDimensions);
+    }
+    accumulator.computed[perspective] = true;
+}
+
+void NNUE::Update(int perspective) {
+    // Find the closest ply that is still valid, unless our king has moved since
+    int start = ply;
+    while (!stack[start].computed[perspective]) {
+        if (start == 0 || stack[start].dirty.kingMoved[perspective]) {
+            Refresh(stack[ply], perspective);
+            return;
+        }
+        --start;
+    }
+
+    const Gamestate& gamestate = Gamestate::Get();
+    const int16_t* featureWeights = NNUENetwork::Get().weights->featureWeights;
+    int kingSquare = squareOf(perspective == 0 ? gamestate.w_king : gamestate.b_king);
+
+    for (int i = start + 1; i <= ply; ++i) {
+        Accumulator& accumulator = stack[i];
+        std::memcpy(accumulator.values[perspective], stack[i - 1].values[perspective], sizeof(accumulator.values[perspective]));
+
+        const DirtyPieces& dirty = accumulator.dirty;
+        for (int j = 0; j < dirty.count; ++j) {
+            const int16_t* column = featureWeights + FeatureIndex(perspective, kingSquare, dirty.piece[j], dirty.square[j]) * halfDimensions;
+            if (dirty.added[j]) {
+                AddColumn(accumulator.values[perspective], column);
+            } else {
+                SubColumn(accumulator.values[perspective], column);
+            }
+        }
+        accumulator.computed[perspective] = true;
+    }
+}
+
+int NNUE::Evaluate() {
+    Update(0);
+    Update(1);
+
+    const NNUENetwork::Weights& weights = *NNUENetwork::Get().weights;
+    const Accumulator& accumulator = stack[ply];
+    int us = Gamestate::Get().whiteToMove ? 0 : 1;
+
+    alignas(32) uint8_t input[2 * halfDimensions];
+    alignas(32) uint8_t hidden1Output[hidden1];
+    alignas(32) uint8_t hidden2Output[hidden2];
+
+    ClipAccumulator(accumulator.values[us], input);
+    ClipAccumulator(accumulator.values[us ^ 1], input + halfDimensions);
+
+    DenseClipped<2 * halfDimensions, hidden1>(input, weights.hidden1Weights, weights.hidden1Biases, hidden1Output);
+    DenseClipped<hidden1, hidden2>(hidden1Output, weights.hidden2Weights, weights.hidden2Biases, hidden2Output);
+
+    int32_t output = weights.outputBias + DotProduct(hidden2Output, weights.outputWeights, hidden2);
+    return output / outputScale;
+}
@@ -0,0 +1,114 @@
+#ifndef CHESS_ENGINE_NNUE_H
+#define CHESS_ENGINE_NNUE_H
+
+#include "gamestate.h"
+#include "move.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+// HalfKP: every non-king piece is a feature relative to each side's own king.
+// (64 king squares x 10 pieces x 64 squares) -> 2 x 256 -> 32 -> 32 -> 1
+namespace NNUEArch {
+    const int featureCount = 64 * 10 * 64;
+    const int halfDimensions = 256;
+    const int hidden1 = 32;
+    const int hidden2 = 32;
+
+    const int maxActivation = 127;
+    const int weightShift = 6;  // hidden layer weights are scaled by 64
+    const int outputScale = 16; // network output per centipawn
+}
+
+/* Weights file, every value little endian:
+ *   char[4]  magic "CENN"
+ *   uint32   version, currently 1
+ *   uint32   featureCount, halfDimensions, hidden1, hidden2 (must match NNUEArch)
+ *   int16    feature biases [halfDimensions]
+ *   int16    feature weights [featureCount][halfDimensions]
+ *   int32    hidden1 biases [hidden1]
+ *   int8     hidden1 weights [hidden1][2 * halfDimensions], side to move's half first
+ *   int32    hidden2 biases [hidden2]
+ *   int8     hidden2 weights [hidden2][hidden1]
+ *   int32    output bias
+ *   int8     output weights [hidden2]
+ */
+class NNUENetwork {
+private:
+    NNUENetwork() = default;
+
+    struct Weights {
+        alignas(32) int16_t featureBiases[NNUEArch::halfDimensions];
+        alignas(32) int16_t featureWeights[NNUEArch::featureCount * NNUEArch::halfDimensions];
+        alignas(32) int32_t hidden1Biases[NNUEArch::hidden1];
+        alignas(32) int8_t hidden1Weights[NNUEArch::hidden1 * 2 * NNUEArch::halfDimensions];
+        alignas(32) int32_t hidden2Biases[NNUEArch::hidden2];
+        alignas(32) int8_t hidden2Weights[NNUEArch::hidden2 * NNUEArch::hidden1];
+        alignas(32) int8_t outputWeights[NNUEArch::hidden2];
+        int32_t outputBias;
+    };
+
+    std::unique_ptr<Weights> weights;
+
+    friend class NNUE;
+
+public:
+    static NNUENetwork& Get() {
+        static NNUENetwork instance;
+        return instance;
+    }
+
+    NNUENetwork(const NNUENetwork&) = delete;
+
+    // Not safe while a search is running, load before the game starts
+    bool Load(const std::string& path);
+    bool IsLoaded() const { return weights != nullptr; }
+};
+
+// Accumulators for the current line of play, one per ply. MakeMove only records which
+// pieces changed; the accumulator is brought up to date when a position is evaluated.
+class NNUE {
+private:
+    NNUE() = default;
+
+    struct DirtyPieces {
+        int count = 0;
+        int piece[3];
+        int square[3];
+        bool added[3];
+        bool kingMoved[2] = {false, false}; // indexed by color, forces a refresh
+    };
+
+    struct Accumulator {
+        alignas(32) int16_t values[2][NNUEArch::halfDimensions];
+        bool computed[2];
+        DirtyPieces dirty;
+    };
+
+    void Refresh(Accumulator& accumulator, int perspective);
+    void Update(int perspective);
+    int FeatureIndex(int perspective, int kingSquare, int piece, int square);
+
+    std::vector<Accumulator> stack;
+    int ply = 0;
+    bool active = false;
+
+public:
+    static NNUE& Get() {
+        static thread_local NNUE instance;
+        return instance;
+    }
+
+    // Called by Gamestate, Push before the board changes
+    void Reset();
+    void Push(Move move, const Gamestate& gamestate);
+    void Pop();
+
+    bool IsActive() const { return active; }
+    int Evaluate(); // centipawns from the side to move's point of view
+};
+
+
+#endif //CHESS_ENGINE_NNUE_H
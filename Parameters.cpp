@@ -0,0 +1,90 @@
+#include "Parameters.h"
+#include <sstream>
+
+
+const std::vector<Parameters::Info>& Parameters::All() {
+    static const std::vector<Info> parameters = {
+            {"mobilityMidGame", &Parameters::mobilityMidGame, 0, 20},
+            {"mobilityEndGame", &Parameters::mobilityEndGame, 0, 20},
+            {"kingAttackMidGame", &Parameters::kingAttackMidGame, 0, 40},
+            {"kingAttackEndGame", &Parameters::kingAttackEndGame, 0, 40},
+            {"spaceMidGame", &Parameters::spaceMidGame, 0, 20},
+            {"spaceEndGame", &Parameters::spaceEndGame, 0, 20},
+            {"blockedCenterPawnMidGame", &Parameters::blockedCenterPawnMidGame, 0, 150},
+            {"blockedCenterPawnEndGame", &Parameters::blockedCenterPawnEndGame, 0, 150},
+
+            {"deepeningStep", &Parameters::deepeningStep, 1, 3},
+            {"captureByPawn", &Parameters::captureByPawn, 0, 1500},
+            {"captureByKnight", &Parameters::captureByKnight, 0, 1500},
+            {"captureByBishop", &Parameters::captureByBishop, 0, 1500},
+            {"captureByRook", &Parameters::captureByRook, 0, 1500},
+            {"captureByQueen", &Parameters::captureByQueen, 0, 1500},
+            {"captureByKing", &Parameters::captureByKing, 0, 1500},
+    };
+    return parameters;
+}
+
+bool Parameters::Set(const std::string& name, int value) {
+    for (const Info& info : All()) {
+        if (name != info.name) continue;
+        if (value < info.min || value > info.max) return false;
+
+        this->*info.value = value;
+        UpdateKey();
+        return true;
+    }
+    return false;
+}
+
+bool Parameters::Value(const std::string& name, int& value) const {
+    for (const Info& info : All()) {
+        if (name == info.name) {
+            value = this->*info.value;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Parameters::Apply(const std::string& assignments) {
+    std::istringstream stream(assignments);
+    std::string assignment;
+    while (std::getline(stream, assignment, ',')) {
+        if (assignment.empty()) continue;
+
+        size_t split = assignment.find('=');
+        if (split == std::string::npos) return false;
+
+        try {
+            if (!Set(assignment.substr(0, split), std::stoi(assignment.substr(split + 1)))) return false;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string Parameters::ToString() const {
+    std::string text;
+    for (const Info& info : All()) {
+        if (!text.empty()) text += ',';
+        text += std::string(info.name) + "=" + std::to_string(this->*info.value);
+    }
+    return text;
+}
+
+void Parameters::UpdateKey() {
+    static const Parameters defaults;
+
+    // Each changed value contributes a well mixed word, so the defaults hash to zero
+    key = 0;
+    for (size_t i = 0; i < All().size(); ++i) {
+        int value = this->*All()[i].value;
+        if (value == defaults.*All()[i].value) continue;
+
+        U64 mixed = (static_cast<U64>(i) << 32 | static_cast<uint32_t>(value)) + 0x9E3779B97F4A7C15ULL;
+        mixed = (mixed ^ mixed >> 30) * 0xBF58476D1CE4E5B9ULL;
+        mixed = (mixed ^ mixed >> 27) * 0x94D049BB133111EBULL;
+        key ^= mixed ^ mixed >> 31;
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef CHESS_ENGINE_PARAMETERS_H
+#define CHESS_ENGINE_PARAMETERS_H
+
+#include "evaluation.h"
+#include <string>
+#include <vector>
+
+
+// Evaluation weights and search settings that can be changed by name at run time, so matches
+// and tuners can try other values without a rebuild. Every thread has its own copy, set with
+// Get() = other.
+class Parameters {
+public:
+    static Parameters& Get() {
+        static thread_local Parameters instance;
+        return instance;
+    }
+
+    // Read freely, but change them with Set or Apply so the key follows
+
+    // Evaluation
+    int mobilityMidGame = MidGameValue(ActivityWeights::mobility);
+    int mobilityEndGame = EndGameValue(ActivityWeights::mobility);
+    int kingAttackMidGame = MidGameValue(ActivityWeights::kingAttack);
+    int kingAttackEndGame = EndGameValue(ActivityWeights::kingAttack);
+    int spaceMidGame = MidGameValue(ActivityWeights::space);
+    int spaceEndGame = EndGameValue(ActivityWeights::space);
+    int blockedCenterPawnMidGame = MidGameValue(ActivityWeights::blockedCenterPawn);
+    int blockedCenterPawnEndGame = EndGameValue(ActivityWeights::blockedCenterPawn);
+
+    // Search
+    int deepeningStep = 2; // plies added by each iteration of iterative deepening
+
+    // Move ordering bonus for a capture, by the capturing piece, so cheap attackers go first
+    int captureByPawn = 900;
+    int captureByKnight = 550;
+    int captureByBishop = 500;
+    int captureByRook = 200;
+    int captureByQueen = 100;
+    int captureByKing = 50;
+
+    int CaptureBonus(int piece) const {
+        static int Parameters::* const bonuses[7] = {nullptr, &Parameters::captureByPawn, &Parameters::captureByKnight,
+                                                     &Parameters::captureByBishop, &Parameters::captureByRook,
+                                                     &Parameters::captureByQueen, &Parameters::captureByKing};
+        return this->*bonuses[piece & 0b0111];
+    }
+
+    struct Info {
+        const char* name;
+        int Parameters::* value;
+        int min, max;
+    };
+    static const std::vector<Info>& All();
+
+    // False for an unknown name or a value out of range
+    bool Set(const std::string& name, int value);
+    bool Value(const std::string& name, int& value) const;
+
+    // Assignments like "mobilityMidGame=5,spaceMidGame=2"
+    bool Apply(const std::string& assignments);
+    std::string ToString() const;
+
+    // Zero with the default values, otherwise mixed into the cache keys so evaluations
+    // and searches made with different values never share an entry
+    U64 Key() const { return key; }
+
+private:
+    U64 key = 0;
+    void UpdateKey();
+};
+
+
+#endif //CHESS_ENGINE_PARAMETERS_H
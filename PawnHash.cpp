@@ -0,0 +1,62 @@
+#include "PawnHash.h"
+#include "movegen.h"
+#include "bitUtils.h"
+
+
+PawnHashTable::PawnHashTable() {
+    entries.resize(tableSize);
+    Clear();
+}
+
+void PawnHashTable::Clear() {
+    // Key 0 is the position without pawns, so the empty table is already correct for it
+    PawnEntry noPawns;
+    EvaluatePawns(noPawns, 0, 0);
+    std::fill(entries.begin(), entries.end(), noPawns);
+}
+
+const PawnEntry& PawnHashTable::Probe() {
+    const Gamestate& gamestate = Gamestate::Get();
+    PawnEntry& entry = entries[gamestate.pawnKey & (tableSize - 1)];
+
+    if (entry.key != gamestate.pawnKey) {
+        entry.key = gamestate.pawnKey;
+        EvaluatePawns(entry, gamestate.w_pawn, gamestate.b_pawn);
+    }
+    return entry;
+}
+
+void PawnHashTable::EvaluatePawns(PawnEntry& entry, U64 whitePawns, U64 blackPawns) {
+    U64 whiteFiles = BitMasks::fileFill(whitePawns);
+    U64 blackFiles = BitMasks::fileFill(blackPawns);
+
+    entry.pawnAttacks[0] = PawnMoves::allCaptures(true, whitePawns);
+    entry.pawnAttacks[1] = PawnMoves::allCaptures(false, blackPawns);
+    entry.attackSpans[0] = BitMasks::northFill(entry.pawnAttacks[0]);
+    entry.attackSpans[1] = BitMasks::southFill(entry.pawnAttacks[1]);
+
+    entry.halfOpenFiles[0] = ~whiteFiles;
+    entry.halfOpenFiles[1] = ~blackFiles;
+    entry.openFiles = ~whiteFiles & ~blackFiles;
+
+    // A pawn is passed when no enemy pawn stands in front of it or can ever capture it
+    entry.passedPawns[0] = whitePawns & ~(BitMasks::southFill(blackPawns >> 8) | entry.attackSpans[1]);
+    entry.passedPawns[1] = blackPawns & ~(BitMasks::northFill(whitePawns << 8) | entry.attackSpans[0]);
+
+    U64 whiteNeighbours = (whiteFiles & ~Board::Files::hFile) << 1 | (whiteFiles & ~Board::Files::aFile) >> 1;
+    U64 blackNeighbours = (blackFiles & ~Board::Files::hFile) << 1 | (blackFiles & ~Board::Files::aFile) >> 1;
+
+    Score score = 0;
+
+    score -= PawnWeights::doubledPawn * bit_cnt(whitePawns & BitMasks::northFill(whitePawns) << 8);
+    score += PawnWeights::doubledPawn * bit_cnt(blackPawns & BitMasks::southFill(blackPawns) >> 8);
+    score -= PawnWeights::isolatedPawn * bit_cnt(whitePawns & ~whiteNeighbours);
+    score += PawnWeights::isolatedPawn * bit_cnt(blackPawns & ~blackNeighbours);
+
+    U64 passed = entry.passedPawns[0];
+    while (passed) score += PawnWeights::passedPawn[popLSB(passed) / 8];
+    passed = entry.passedPawns[1];
+    while (passed) score -= PawnWeights::passedPawn[7 - popLSB(passed) / 8];
+
+    entry.score = score;
+}
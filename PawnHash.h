@@ -0,0 +1,52 @@
+#ifndef CHESS_ENGINE_PAWNHASH_H
+#define CHESS_ENGINE_PAWNHASH_H
+
+#include "gamestate.h"
+#include "evaluation.h"
+#include <array>
+#include <vector>
+
+
+struct PawnEntry {
+    U64 key = 0;
+    Score score = 0; // from white's point of view
+
+    // Indexed by color, white first
+    std::array<U64, 2> passedPawns;
+    std::array<U64, 2> pawnAttacks;
+    std::array<U64, 2> attackSpans;   // every square the pawns could attack as they advance
+    std::array<U64, 2> halfOpenFiles; // files without a pawn of that color
+    U64 openFiles;
+};
+
+class PawnHashTable {
+private:
+    PawnHashTable();
+
+    void EvaluatePawns(PawnEntry& entry, U64 whitePawns, U64 blackPawns);
+
+    static const int tableSize = 1 << 14; // must be a power of two
+    std::vector<PawnEntry> entries;
+
+public:
+    static PawnHashTable& Get() {
+        static thread_local PawnHashTable instance;
+        return instance;
+    }
+
+    const PawnEntry& Probe();
+    void Clear();
+};
+
+namespace PawnWeights {
+    // By rank, from the pawn's side. Passed pawns matter most once the pieces come off.
+    const Score passedPawn[8] = {S(0, 0), S(2, 8), S(5, 15), S(10, 30), S(18, 52), S(30, 90), S(50, 150), S(0, 0)};
+    const Score doubledPawn = S(8, 16);
+    const Score isolatedPawn = S(12, 12);
+
+    const Score rookHalfOpenFile = S(10, 10);
+    const Score rookOpenFile = S(20, 20);
+}
+
+
+#endif //CHESS_ENGINE_PAWNHASH_H
@@ -0,0 +1,64 @@
+#include "PerftTable.h"
+
+
+PerftTable::PerftTable() {
+    Resize(64);
+}
+
+void PerftTable::Resize(int megabytes) {
+    U64 bucketCount = 1;
+    while (2 * bucketCount * sizeof(Bucket) <= static_cast<U64>(megabytes) << 20) {
+        bucketCount *= 2;
+    }
+
+    buckets = std::make_unique<Bucket[]>(bucketCount);
+    bucketMask = bucketCount - 1;
+    probes = 0;
+    hits = 0;
+}
+
+void PerftTable::Clear() {
+    for (U64 bucket = 0; bucket <= bucketMask; ++bucket) {
+        for (Slot& slot : buckets[bucket].slots) {
+            slot.keyXorData.store(0, std::memory_order_relaxed);
+            slot.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    probes = 0;
+    hits = 0;
+}
+
+U64 PerftTable::Key(U64 zobristKey, int depth) {
+    // The same position counted to another depth is a different entry
+    return zobristKey ^ static_cast<U64>(depth) * 0x9e3779b97f4a7c15ULL;
+}
+
+bool PerftTable::Probe(U64 zobristKey, int depth, U64& nodes) {
+    probes.fetch_add(1, std::memory_order_relaxed);
+    U64 key = Key(zobristKey, depth);
+
+    for (Slot& slot : buckets[key & bucketMask].slots) {
+        U64 data = slot.data.load(std::memory_order_relaxed);
+        if (!data || (slot.keyXorData.load(std::memory_order_relaxed) ^ data) != key) continue;
+        if (static_cast<int>(data >> 56) != depth) continue;
+
+        hits.fetch_add(1, std::memory_order_relaxed);
+        nodes = data & 0xffffffffffffffULL;
+        return true;
+    }
+    return false;
+}
+
+void PerftTable::Store(U64 zobristKey, int depth, U64 nodes) {
+    U64 key = Key(zobristKey, depth);
+    Bucket& bucket = buckets[key & bucketMask];
+
+    Slot* slot = &bucket.slots[1];
+    if (static_cast<int>(bucket.slots[0].data.load(std::memory_order_relaxed) >> 56) <= depth) {
+        slot = &bucket.slots[0];
+    }
+
+    U64 data = static_cast<U64>(depth) << 56 | (nodes & 0xffffffffffffffULL);
+    slot->data.store(data, std::memory_order_relaxed);
+    slot->keyXorData.store(key ^ data, std::memory_order_relaxed);
+}
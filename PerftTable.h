@@ -0,0 +1,49 @@
+#ifndef CHESS_ENGINE_PERFTTABLE_H
+#define CHESS_ENGINE_PERFTTABLE_H
+
+
+#include "gamestate.h"
+#include <atomic>
+#include <memory>
+
+
+// Node counts of subtrees already walked by perft, so transpositions are only counted once
+class PerftTable {
+private:
+    PerftTable();
+
+    // Shared between perft threads without locks, the same way as the transposition table
+    struct Slot {
+        std::atomic<U64> keyXorData = 0;
+        std::atomic<U64> data = 0;  // node count, with the depth in the top byte
+    };
+
+    // The first slot keeps the deepest subtree, the second the latest
+    struct Bucket {
+        Slot slots[2];
+    };
+
+    static U64 Key(U64 zobristKey, int depth);
+
+    std::unique_ptr<Bucket[]> buckets;
+    U64 bucketMask;
+
+public:
+    static PerftTable& Get() {
+        static PerftTable instance;
+        return instance;
+    }
+
+    void Resize(int megabytes);
+    void Clear();
+
+    bool Probe(U64 zobristKey, int depth, U64& nodes);
+    void Store(U64 zobristKey, int depth, U64 nodes);
+
+    double HitRate() const { return probes ? static_cast<double>(hits) / probes : 0; }
+
+    std::atomic<U64> probes = 0, hits = 0;
+};
+
+
+#endif //CHESS_ENGINE_PERFTTABLE_H
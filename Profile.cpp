@@ -0,0 +1,82 @@
+#include "Profile.h"
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+
+namespace {
+    std::mutex registryMutex;
+    std::vector<Profile::Counters*> liveCounters;
+    Profile::Counters retiredCounters; // from threads that have ended
+
+    void Add(Profile::Counters& total, const Profile::Counters& counters) {
+        for (int section = 0; section < Profile::SectionCount; ++section) {
+            total.calls[section] += counters.calls[section];
+            total.cycles[section] += counters.cycles[section];
+        }
+    }
+
+    struct RegisteredCounters {
+        Profile::Counters counters;
+
+        RegisteredCounters() {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            liveCounters.push_back(&counters);
+        }
+
+        ~RegisteredCounters() {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            Add(retiredCounters, counters);
+            std::erase(liveCounters, &counters);
+        }
+    };
+}
+
+Profile::Counters& Profile::ThreadCounters() {
+    static thread_local RegisteredCounters registered;
+    return registered.counters;
+}
+
+Profile::Counters Profile::Totals() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    Counters total = retiredCounters;
+    for (const Counters* counters : liveCounters) Add(total, *counters);
+    return total;
+}
+
+void Profile::Reset() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    retiredCounters = Counters();
+    for (Counters* counters : liveCounters) *counters = Counters();
+}
+
+std::string Profile::Report() {
+    Counters total = Totals();
+    uint64_t allCycles = 0;
+    for (uint64_t cycles : total.cycles) allCycles += cycles;
+
+    std::ostringstream report;
+    report << std::left << std::setw(20) << "section" << std::right << std::setw(14) << "calls" << std::setw(16)
+           << "cycles" << std::setw(12) << "per call" << std::setw(9) << "share" << '\n';
+    for (int section = 0; section < SectionCount; ++section) {
+        uint64_t calls = total.calls[section], cycles = total.cycles[section];
+        report << std::left << std::setw(20) << sectionNames[section] << std::right << std::setw(14) << calls
+               << std::setw(16) << cycles << std::setw(12) << std::fixed << std::setprecision(1)
+               << (calls ? static_cast<double>(cycles) / calls : 0) << std::setw(8)
+               << (allCycles ? 100.0 * cycles / allCycles : 0) << "%\n";
+    }
+    return report.str();
+}
+
+std::string Profile::ToJSON() {
+    Counters total = Totals();
+    std::ostringstream json;
+    json << "{";
+    for (int section = 0; section < SectionCount; ++section) {
+        json << (section ? "," : "") << "\"" << sectionNames[section] << "\":{\"calls\":" << total.calls[section]
+             << ",\"cycles\":" << total.cycles[section] << "}";
+    }
+    json << "}";
+    return json.str();
+}
@@ -0,0 +1,89 @@
+#ifndef CHESS_ENGINE_PROFILE_H
+#define CHESS_ENGINE_PROFILE_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+
+// Call counts and cycles spent in the engine's hot functions. PROFILE_SCOPE only expands to a
+// timer when built with ENABLE_PROFILING, so release builds pay nothing for it. Times are
+// inclusive: a StaticEvaluation that generates attack maps also counts towards its own row.
+namespace Profile {
+    enum Section {
+        MakeMove,
+        UndoMove,
+        GenerateLegalMoves,
+        StaticEvaluation,
+        OrderMoves,
+        TTProbe,
+        TTStore,
+        SectionCount
+    };
+
+    inline const char* const sectionNames[SectionCount] = {
+            "MakeMove", "UndoMove", "GenerateLegalMoves", "StaticEvaluation", "OrderMoves", "TTProbe", "TTStore",
+    };
+
+#ifdef ENABLE_PROFILING
+    inline constexpr bool enabled = true;
+#else
+    inline constexpr bool enabled = false;
+#endif
+
+    struct Counters {
+        std::array<uint64_t, SectionCount> calls = {};
+        std::array<uint64_t, SectionCount> cycles = {};
+    };
+
+    // This thread's counters, folded into the totals when the thread ends
+    Counters& ThreadCounters();
+
+    // Every thread's counters added together
+    Counters Totals();
+    void Reset();
+
+    // A table of calls, cycles per call and share of the profiled cycles, and the same as JSON
+    std::string Report();
+    std::string ToJSON();
+
+    inline uint64_t ReadCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    class ScopedTimer {
+    private:
+        Section section;
+        uint64_t start;
+
+    public:
+        explicit ScopedTimer(Section timedSection) : section(timedSection), start(ReadCycles()) {}
+        ~ScopedTimer() {
+            Counters& counters = ThreadCounters();
+            ++counters.calls[section];
+            counters.cycles[section] += ReadCycles() - start;
+        }
+    };
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#ifdef ENABLE_PROFILING
+#define PROFILE_SCOPE(section) Profile::ScopedTimer PROFILE_CONCAT(profileTimer, __LINE__)(Profile::section)
+#else
+#define PROFILE_SCOPE(section)
+#endif
+
+
+#endif //CHESS_ENGINE_PROFILE_H
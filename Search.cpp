@@ -4,62 +4,231 @@
 
 #include "Search.h"
 #include "evaluation.h"
+#include "Bitbase.h"
+#include "Tablebase.h"
+#include "Parameters.h"
+#include "SearchStats.h"
+#include "Profile.h"
+#include <algorithm>
 #include <thread>
 
 MovePicker::MovePicker() {
 
 }
 
-void MovePicker::InitSearch() {
-    int searchDepth = 2;
-    start = std::chrono::steady_clock::now();
+void MovePicker::InitSearch(const SearchLimits& limits) {
+    int depthLimit = limits.depth > 0 ? std::min(limits.depth, maxDepth) : maxDepth;
+    int searchDepth = std::min(2, depthLimit);
+    int iterationStart, lastIterationTime;
+    bool bestMoveChanged;
+
+    timeManager.StartSearch(limits);
+    TranspositionTable::Get().NewSearch();
+    SearchStats::Get().Reset();
     abortSearch = false;
-    while (true) {
-        bestEvalThisIteration = Gamestate::Get().whiteToMove ? -Infinity : Infinity;
-        int curr_eval = NegaMaxSearch(searchDepth, 0, -Infinity, Infinity);
+    nodes = 0;
+    nodeLimit = limits.nodes;
+    completedDepth = 0;
+
+    // Keep a legal move on hand in case the search is stopped during the first iteration
+    std::vector<Move> rootMoves = MoveGenerator::Get().GenerateLegalMoves();
+    bestMove = bestMoveThisIteration = rootMoves.empty() ? Move() : rootMoves[0];
+    bestEval = -Infinity;
+    principalVariation = {bestMove};
+    lines = {{bestMove, bestEval, principalVariation}};
+
+    // Mate or stalemate already, there is nothing to search
+    if (rootMoves.empty()) {
+        bestEval = MoveGenerator::Get().king_is_in_check ? -Infinity : 0;
+        principalVariation.clear();
+        lines = {{bestMove, bestEval, {}}};
+        return;
+    }
 
-        if (abortSearch) {
-            if (curr_eval > bestEval) {
-                bestEval = bestEvalThisIteration;
-                bestMove = bestMoveThisIteration;
+    int lineCount = std::clamp(limits.multiPV, 1, static_cast<int>(rootMoves.size()));
+
+    while (true) {
+        iterationStart = timeManager.Elapsed();
+
+        // Every line after the first searches the root again without the moves already found.
+        // Below the root the transposition table is shared, so the later lines come cheaply.
+        std::vector<SearchLine> iterationLines;
+        excludedRootMoves.clear();
+        for (int line = 0; line < lineCount; ++line) {
+            if (line < static_cast<int>(lines.size())) bestMoveThisIteration = lines[line].move;
+            bestEvalThisIteration = Gamestate::Get().whiteToMove ? -Infinity : Infinity;
+            int curr_eval = NegaMaxSearch(searchDepth, 0, -Infinity, Infinity);
+
+            if (abortSearch) {
+                if (line == 0 && curr_eval > bestEval) {
+                    bestEval = bestEvalThisIteration;
+                    bestMove = bestMoveThisIteration;
+                }
+                break;
             }
+            if (bestMoveThisIteration.flag == MoveFlags::nullMove) break; // the tablebases left fewer moves
+
+            iterationLines.push_back({bestMoveThisIteration, bestEvalThisIteration,
+                                      {pvTable[0].begin(), pvTable[0].begin() + pvLength[0]}});
+            excludedRootMoves.push_back(bestMoveThisIteration);
+        }
+        excludedRootMoves.clear();
+
+        if (abortSearch || iterationLines.empty()) {
             break;
         }
 
-        bestMove = bestMoveThisIteration;
-        bestEval = bestEvalThisIteration;
+        // The first line had every move to choose from, so it stays first whatever the others score
+        std::stable_sort(iterationLines.begin() + 1, iterationLines.end(),
+                         [](const SearchLine& a, const SearchLine& b) { return a.eval > b.eval; });
+
+        bestMoveChanged = searchDepth > 2 &&
+                          (iterationLines[0].move.startSquare != bestMove.startSquare ||
+                           iterationLines[0].move.endSquare != bestMove.endSquare);
+
+        bestMove = iterationLines[0].move;
+        bestEval = iterationLines[0].eval;
+        principalVariation = iterationLines[0].pv;
+        lines = iterationLines;
+        completedDepth = searchDepth;
+        SearchStats::Get().RecordIteration(searchDepth, timeManager.Elapsed());
 
         if (isMateEval(bestEval)) {
             break;
         }
 
-        searchDepth += 2;
+        timeManager.ReportIteration(bestMoveChanged);
+        lastIterationTime = timeManager.Elapsed() - iterationStart;
+        int nextDepth = std::min(searchDepth + Parameters::Get().deepeningStep, depthLimit);
+        if (searchDepth >= depthLimit || !timeManager.CanStartIteration(lastIterationTime, nextDepth - searchDepth)) {
+            break;
+        }
+
+        searchDepth = nextDepth;
+    }
+
+    // Stopped before the first iteration finished, whose move and score are only half searched.
+    // Play the table's move if it has a legal one, or else the first, scored by a capture search.
+    if (completedDepth == 0) {
+        Move tableMove = TranspositionTable::Get().GetBestMove();
+        auto legal = std::find_if(rootMoves.begin(), rootMoves.end(), [tableMove](Move move) {
+            return move.startSquare == tableMove.startSquare && move.endSquare == tableMove.endSquare &&
+                   move.flag == tableMove.flag;
+        });
+        bestMove = legal != rootMoves.end() ? *legal : rootMoves[0];
+
+        bool aborted = abortSearch;
+        abortSearch = false;
+        Gamestate::Get().MakeMove(bestMove);
+        bestEval = -QuiessenceSearch(-Infinity, Infinity);
+        if (abortSearch) bestEval = -Evaluator::Get().StaticEvaluation(); // the limits cut that short too
+        Gamestate::Get().UndoMove();
+        abortSearch = aborted;
+
+        principalVariation = {bestMove};
+        lines = {{bestMove, bestEval, principalVariation}};
+    }
+
+    // A ponder search must not answer before the opponent has moved
+    while (timeManager.IsPondering() && !abortSearch) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        PollSignals();
     }
 }
 
+void MovePicker::CheckTime() {
+    // Reading the clock is expensive, so only do it every few thousand nodes
+    if ((++nodes & (timeCheckInterval - 1)) == 0) {
+        PollSignals();
+    }
+    if (nodeLimit && nodes >= nodeLimit) {
+        abortSearch = true;
+    }
+}
+
+void MovePicker::PollSignals() {
+    if (ponderHitSignal && ponderHitSignal->exchange(false)) {
+        timeManager.PonderHit();
+    }
+    if (timeManager.HardLimitReached() || (stopSignal && stopSignal->load(std::memory_order_relaxed))) {
+        abortSearch = true;
+    }
+}
+
+bool MovePicker::IsExcluded(Move move) const {
+    return std::any_of(excludedRootMoves.begin(), excludedRootMoves.end(), [move](Move excluded) {
+        return excluded.startSquare == move.startSquare && excluded.endSquare == move.endSquare &&
+               excluded.flag == move.flag;
+    });
+}
+
+void MovePicker::UpdatePV(int depth_from_root, Move move) {
+    if (depth_from_root + 1 >= MaxPly) return;
+
+    pvTable[depth_from_root][0] = move;
+    for (int ply = 0; ply < pvLength[depth_from_root + 1]; ++ply) {
+        pvTable[depth_from_root][ply + 1] = pvTable[depth_from_root + 1][ply];
+    }
+    pvLength[depth_from_root] = pvLength[depth_from_root + 1] + 1;
+}
+
 int MovePicker::NegaMaxSearch(int depth_to_search, int depth_from_root, int alpha, int beta) {
-    abortSearch = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count() > search_time;
+    CheckTime();
     if (abortSearch) {
         return alpha;
     }
 
+    SearchStats& stats = SearchStats::Get();
+    ++stats.nodes;
+
+    if (depth_from_root < MaxPly) {
+        pvLength[depth_from_root] = 0;
+    }
+
     if (depth_from_root > 0) {
+        // Either side could steer back into a repeated position, so a single repetition is already a draw
+        const Gamestate& position = Gamestate::Get();
+        if (position.halfmoveClock >= 100 || position.IsRepetition()) return 0;
+
         alpha = std::max(alpha, -Infinity + depth_from_root);
         beta = std::min(beta, Infinity - depth_from_root);
     }
 
-    int transposition_eval = TranspositionTable::Get().Lookup(depth_to_search, depth_from_root, alpha, beta);
+    // With root moves left out the root's score isn't the position's, so it stays out of the table
+    bool excluding = depth_from_root == 0 && !excludedRootMoves.empty();
+
+    int transposition_eval = excluding ? LookUpFailed
+                                       : TranspositionTable::Get().Lookup(depth_to_search, depth_from_root, alpha, beta);
     if (transposition_eval != LookUpFailed) {
+        ++stats.ttCutoffs;
         if (depth_from_root == 0) {
             bestEvalThisIteration = transposition_eval;
-            bestMoveThisIteration = TranspositionTable::Get().positions.at(Gamestate::Get().zobristKey).bestMove;
+            bestMoveThisIteration = TranspositionTable::Get().GetBestMove();
+            pvTable[0][0] = bestMoveThisIteration;
+            pvLength[0] = 1;
         }
         return transposition_eval;
     }
 
+    // Nothing below a bitbase draw can change the score. Wins are still searched so mates are found.
+    int bitbaseResult;
+    if (depth_from_root > 0 && Bitbases::Get().Probe(Gamestate::Get(), bitbaseResult) && bitbaseResult == 0) {
+        return 0;
+    }
+
+    // The tablebases settle the result outright, the root's move filter takes care of making progress
+    int wdl, dtz;
+    if (depth_from_root > 0 && Tablebases::Get().Probe(Gamestate::Get(), wdl, dtz)) {
+        return wdl * (TablebaseWin - depth_from_root);
+    }
+
     if (depth_to_search == 0) {
+        // The capture search fails hard, so a score on the window's edge is only a bound
         int eval = QuiessenceSearch(alpha, beta);
-        TranspositionTable::Get().StorePosition(depth_to_search, depth_from_root, eval, Exact, {0, 0, 0});
+        if (abortSearch) return alpha;
+
+        EvaluationType type = eval >= beta ? WorstCase : eval <= alpha ? BestCase : Exact;
+        TranspositionTable::Get().StorePosition(depth_to_search, depth_from_root, eval, type, {0, 0, 0});
         return eval;
     }
 
@@ -79,16 +248,34 @@ int MovePicker::NegaMaxSearch(int depth_to_search, int depth_from_root, int alph
         return 0;
     }
 
+    if (depth_from_root == 0) {
+        Tablebases::Get().FilterRootMoves(legal_moves);
+    }
+
+    if (excluding) {
+        std::erase_if(legal_moves, [this](Move move) { return IsExcluded(move); });
+        if (legal_moves.empty()) {
+            bestMoveThisIteration = Move();
+            return alpha;
+        }
+    }
+
     Move current_best_move = legal_moves[0];
     EvaluationType type = BestCase;
 
-    for (Move move : legal_moves) {
+    for (size_t moveIndex = 0; moveIndex < legal_moves.size(); ++moveIndex) {
+        Move move = legal_moves[moveIndex];
         gamestate.MakeMove(move);
         int eval = -NegaMaxSearch(depth_to_search - 1, depth_from_root + 1, -beta, -alpha);
         gamestate.UndoMove();
 
+        // The score of an interrupted subtree is meaningless, keep it out of the table
+        if (abortSearch) return alpha;
+
         if (eval >= beta) {
-            TranspositionTable::Get().StorePosition(depth_to_search, depth_from_root, beta, WorstCase, move);
+            ++stats.betaCutoffs;
+            ++stats.cutoffsByMoveIndex[std::min(moveIndex, stats.cutoffsByMoveIndex.size() - 1)];
+            if (!excluding) TranspositionTable::Get().StorePosition(depth_to_search, depth_from_root, beta, WorstCase, move);
             return beta;
         }
 
@@ -96,6 +283,7 @@ int MovePicker::NegaMaxSearch(int depth_to_search, int depth_from_root, int alph
             current_best_move = move;
             type = Exact;
             alpha = eval;
+            UpdatePV(depth_from_root, move);
 
             if (depth_from_root == 0) {
                 bestEvalThisIteration = eval;
@@ -106,11 +294,17 @@ int MovePicker::NegaMaxSearch(int depth_to_search, int depth_from_root, int alph
         if (beta <= alpha) break;
     }
 
-    TranspositionTable::Get().StorePosition(depth_to_search, depth_from_root, alpha, type, current_best_move);
+    if (!excluding) TranspositionTable::Get().StorePosition(depth_to_search, depth_from_root, alpha, type, current_best_move);
     return alpha;
 }
 
 int MovePicker::QuiessenceSearch(int alpha, int beta) {
+    CheckTime();
+    if (abortSearch) {
+        return alpha;
+    }
+    ++SearchStats::Get().qNodes;
+
     int current_eval = Evaluator::Get().StaticEvaluation();
 
     if (current_eval >= beta) return beta;
@@ -144,6 +338,7 @@ MoveOrderer::MoveOrderer() {
 }
 
 void MoveOrderer::OrderMoves(std::vector<Move>* legalMoves) {
+    PROFILE_SCOPE(OrderMoves);
     if (!legalMoves->size()) {
         return;
     }
@@ -164,7 +359,7 @@ int MoveOrderer::Promise(Move move) {
     }
 
     if (move.flag & MoveFlags::capture) {
-        promise += EvaluatePiece(capturedPiece) + GuardScores.at(movingPiece);
+        promise += EvaluatePiece(capturedPiece) + Parameters::Get().CaptureBonus(movingPiece);
     }
 
     if (move.flag & MoveFlags::promotion) {
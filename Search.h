@@ -9,33 +9,58 @@
 #include "movegen.h"
 #include "move.h"
 #include "Transposition.h"
+#include "TimeManager.h"
+#include <atomic>
 
 inline const int Infinity = INT32_MAX;
+inline const int MaxPly = 128;
 
 class MovePicker {
 private:
     MovePicker();
     int maxDepth = 32;
 
-    bool abortSearch;
-    int search_time = 1000; //ms
-    std::chrono::steady_clock::time_point start;
+    bool abortSearch = false;
+    U64 nodes = 0;
+    U64 nodeLimit = 0;
+    const U64 timeCheckInterval = 2048; // nodes between clock reads, must be a power of two
+
+    std::array<std::array<Move, MaxPly>, MaxPly> pvTable;
+    std::array<int, MaxPly> pvLength;
+
+    // Root moves already given a line this iteration, left out of the search for the next one
+    std::vector<Move> excludedRootMoves;
+
+    void CheckTime();
+    void PollSignals();
+    void UpdatePV(int depth_from_root, Move move);
+    bool IsExcluded(Move move) const;
 
 public:
     static MovePicker& Get() {
-        static MovePicker instance;
+        static thread_local MovePicker instance;
         return instance;
     }
 
     int NegaMaxSearch(int depth_to_search, int depth_from_root, int alpha, int beta);
     int QuiessenceSearch(int alpha, int beta);
-    void InitSearch();
+    void InitSearch(const SearchLimits& limits = SearchLimits());
+
+    TimeManager timeManager;
+    std::atomic<bool>* stopSignal = nullptr;      // set by another thread to end the search early
+    std::atomic<bool>* ponderHitSignal = nullptr; // set by another thread when the pondered move is played
+
+    U64 Nodes() const { return nodes; }
 
     Move bestMove;
     int bestEval;
+    int completedDepth = 0;
 
     Move bestMoveThisIteration;
     int bestEvalThisIteration;
+
+    std::vector<Move> principalVariation;
+    std::vector<SearchLine> lines; // best first, limits.multiPV of them when there are enough moves
 };
 
 class MoveOrderer {
@@ -92,7 +117,7 @@ private:
     };
 public:
     static MoveOrderer& Get() {
-        static MoveOrderer instance;
+        static thread_local MoveOrderer instance;
         return instance;
     }
     int c = 0;
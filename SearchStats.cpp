@@ -0,0 +1,75 @@
+#include "SearchStats.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+
+void SearchStats::Reset() {
+    *this = SearchStats();
+}
+
+void SearchStats::Merge(const SearchStats& other) {
+    nodes += other.nodes;
+    qNodes += other.qNodes;
+    ttProbes += other.ttProbes;
+    ttHits += other.ttHits;
+    ttCutoffs += other.ttCutoffs;
+    betaCutoffs += other.betaCutoffs;
+    for (size_t i = 0; i < cutoffsByMoveIndex.size(); ++i) cutoffsByMoveIndex[i] += other.cutoffsByMoveIndex[i];
+
+    for (const Iteration& iteration : other.iterations) {
+        auto same = std::find_if(iterations.begin(), iterations.end(),
+                                 [&](const Iteration& mine) { return mine.depth == iteration.depth; });
+        if (same == iterations.end()) {
+            iterations.push_back(iteration);
+        } else {
+            same->nodes += iteration.nodes;
+            same->time += iteration.time;
+        }
+    }
+    std::sort(iterations.begin(), iterations.end(),
+              [](const Iteration& a, const Iteration& b) { return a.depth < b.depth; });
+}
+
+void SearchStats::RecordIteration(int depth, int time) {
+    uint64_t before = 0;
+    int timeBefore = 0;
+    for (const Iteration& iteration : iterations) {
+        before += iteration.nodes;
+        timeBefore += iteration.time;
+    }
+    iterations.push_back({depth, nodes + qNodes - before, time - timeBefore});
+}
+
+double SearchStats::TTHitRate() const {
+    return ttProbes ? static_cast<double>(ttHits) / ttProbes : 0;
+}
+
+double SearchStats::FirstMoveCutoffRate() const {
+    return betaCutoffs ? static_cast<double>(cutoffsByMoveIndex[0]) / betaCutoffs : 0;
+}
+
+double SearchStats::BranchingFactor(size_t iteration) const {
+    if (iteration == 0 || iteration >= iterations.size()) return 0;
+
+    const Iteration& previous = iterations[iteration - 1];
+    const Iteration& current = iterations[iteration];
+    if (!previous.nodes || current.depth <= previous.depth) return 0;
+    return std::pow(static_cast<double>(current.nodes) / previous.nodes, 1.0 / (current.depth - previous.depth));
+}
+
+std::string SearchStats::ToJSON() const {
+    std::ostringstream json;
+    json << "{\"nodes\":" << nodes << ",\"qnodes\":" << qNodes << ",\"ttProbes\":" << ttProbes << ",\"ttHits\":"
+         << ttHits << ",\"ttCutoffs\":" << ttCutoffs << ",\"ttHitRate\":" << TTHitRate() << ",\"betaCutoffs\":"
+         << betaCutoffs << ",\"firstMoveCutoffRate\":" << FirstMoveCutoffRate() << ",\"cutoffsByMoveIndex\":[";
+    for (size_t i = 0; i < cutoffsByMoveIndex.size(); ++i) json << (i ? "," : "") << cutoffsByMoveIndex[i];
+
+    json << "],\"iterations\":[";
+    for (size_t i = 0; i < iterations.size(); ++i) {
+        json << (i ? "," : "") << "{\"depth\":" << iterations[i].depth << ",\"nodes\":" << iterations[i].nodes
+             << ",\"time\":" << iterations[i].time << ",\"branchingFactor\":" << BranchingFactor(i) << "}";
+    }
+    json << "]}";
+    return json.str();
+}
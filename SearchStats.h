@@ -0,0 +1,48 @@
+#ifndef CHESS_ENGINE_SEARCHSTATS_H
+#define CHESS_ENGINE_SEARCHSTATS_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Counters for the current search on this thread, reset when it starts. Plain increments, so
+// they cost next to nothing; searches on other threads keep their own and are added with Merge.
+class SearchStats {
+public:
+    static SearchStats& Get() {
+        static thread_local SearchStats instance;
+        return instance;
+    }
+
+    struct Iteration {
+        int depth = 0;
+        uint64_t nodes = 0; // main and quiescence nodes searched by this iteration alone
+        int time = 0;       // ms
+    };
+
+    uint64_t nodes = 0;  // main search
+    uint64_t qNodes = 0; // quiescence search
+    uint64_t ttProbes = 0;
+    uint64_t ttHits = 0;    // an entry for the position was found
+    uint64_t ttCutoffs = 0; // and its score was used without searching
+    uint64_t betaCutoffs = 0;
+    std::array<uint64_t, 8> cutoffsByMoveIndex = {}; // the last counts every later move too
+    std::vector<Iteration> iterations;
+
+    void Reset();
+    void Merge(const SearchStats& other); // iterations are added up by depth
+    void RecordIteration(int depth, int time);
+
+    double TTHitRate() const;
+    double FirstMoveCutoffRate() const;
+
+    // Growth in nodes per ply from the previous iteration, 0 for the first
+    double BranchingFactor(size_t iteration) const;
+
+    std::string ToJSON() const;
+};
+
+
+#endif //CHESS_ENGINE_SEARCHSTATS_H
@@ -0,0 +1,137 @@
+#include "SearchThread.h"
+#include "Search.h"
+#include "gamestate.h"
+#include "evaluation.h"
+#include "Zobrist.h"
+#include "EvalCache.h"
+
+
+SearchThread::SearchThread() {
+    worker = std::thread(&SearchThread::Loop, this);
+}
+
+SearchThread::~SearchThread() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        stopSignal = true;
+    }
+    wakeUp.notify_one();
+    worker.join();
+}
+
+int SearchThread::Submit(SearchRequest request) {
+    Cancel();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    request.id = ++nextId;
+    pending = std::move(request);
+    wakeUp.notify_one();
+    return nextId;
+}
+
+void SearchThread::Stop() {
+    // The search returns the best move found so far. One that hasn't started yet is told
+    // through its request, as Loop clears the signal when it picks the request up.
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending) {
+        pending->stopped = true;
+    } else {
+        stopSignal = true;
+    }
+}
+
+void SearchThread::PonderHit() {
+    // The pondered move was played, the search carries on as a normal one
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending) {
+        pending->limits.ponder = false;
+    } else {
+        ponderHitSignal = true;
+    }
+}
+
+void SearchThread::Cancel() {
+    // The search stops and its result is thrown away
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.reset();
+    finished.reset();
+    if (searchingId != -1) {
+        cancelledId = searchingId;
+        stopSignal = true;
+    }
+}
+
+bool SearchThread::Poll(SearchResult& result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!finished) return false;
+
+    result = *finished;
+    finished.reset();
+    return true;
+}
+
+bool SearchThread::IsBusy() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending || searchingId != -1;
+}
+
+void SearchThread::Loop() {
+    MovePicker::Get().stopSignal = &stopSignal;
+    MovePicker::Get().ponderHitSignal = &ponderHitSignal;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wakeUp.wait(lock, [this] { return quit || pending; });
+        if (quit) return;
+
+        SearchRequest request = std::move(*pending);
+        pending.reset();
+        searchingId = request.id;
+        stopSignal = request.stopped;
+        ponderHitSignal = false;
+        lock.unlock();
+
+        SearchResult result = Search(request);
+
+        lock.lock();
+        if (request.id != cancelledId) {
+            finished = result;
+        }
+        searchingId = -1;
+    }
+}
+
+SearchResult SearchThread::Search(const SearchRequest& request) {
+    Gamestate& gamestate = Gamestate::Get();
+    MovePicker& searcher = MovePicker::Get();
+
+    gamestate.Seed(request.position);
+    for (Move move : request.moves) {
+        gamestate.MakeMove(move);
+    }
+    gamestate.zobristKey = Zobrist::Get().GenerateKey();
+
+    EvalCache& evalCache = EvalCache::Get();
+    U64 probesBefore = evalCache.Probes();
+    U64 hitsBefore = evalCache.Hits();
+
+    Evaluator::Get().callCount = 0;
+    searcher.InitSearch(request.limits);
+
+    SearchResult result;
+    result.id = request.id;
+    result.bestMove = searcher.bestMove;
+    if (searcher.principalVariation.size() > 1) {
+        result.ponderMove = searcher.principalVariation[1];
+    }
+    result.eval = searcher.bestEval;
+    result.lines = searcher.lines;
+    result.evaluations = Evaluator::Get().callCount;
+    if (U64 probes = evalCache.Probes() - probesBefore) {
+        result.evalCacheHitRate = static_cast<double>(evalCache.Hits() - hitsBefore) / probes;
+    }
+    result.stats = SearchStats::Get();
+    result.elapsed = searcher.timeManager.Elapsed();
+    return result;
+}
@@ -0,0 +1,75 @@
+#ifndef CHESS_ENGINE_SEARCHTHREAD_H
+#define CHESS_ENGINE_SEARCHTHREAD_H
+
+#include "move.h"
+#include "TimeManager.h"
+#include "SearchStats.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+struct SearchRequest {
+    int id = 0;
+    std::string position;      // FEN the game was seeded from
+    std::vector<Move> moves;   // moves played since the position was seeded
+    SearchLimits limits;
+    bool stopped = false;      // a stop arrived before the search started
+};
+
+struct SearchResult {
+    int id = 0;
+    Move bestMove;
+    Move ponderMove; // expected reply, a null move if the PV is too short
+    int eval = 0;
+    std::vector<SearchLine> lines; // the best moves with their PVs, as many as limits.multiPV asked for
+    int evaluations = 0;
+    double evalCacheHitRate = 0;
+    SearchStats stats;
+    int elapsed = 0; // ms
+};
+
+class SearchThread {
+private:
+    SearchThread();
+    ~SearchThread();
+
+    void Loop();
+    SearchResult Search(const SearchRequest& request);
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+
+    std::optional<SearchRequest> pending;
+    std::optional<SearchResult> finished;
+
+    std::atomic<bool> stopSignal = false;
+    std::atomic<bool> ponderHitSignal = false;
+    int nextId = 0;
+    int searchingId = -1;
+    int cancelledId = -1;
+    bool quit = false;
+
+public:
+    static SearchThread& Get() {
+        static SearchThread instance;
+        return instance;
+    }
+
+    SearchThread(const SearchThread&) = delete;
+
+    int Submit(SearchRequest request);
+    void Stop();
+    void PonderHit();
+    void Cancel();
+    bool Poll(SearchResult& result);
+    bool IsBusy();
+};
+
+
+#endif //CHESS_ENGINE_SEARCHTHREAD_H
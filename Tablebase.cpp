@@ -0,0 +1,368 @@
+#include "Tablebase.h"
+#include "movegen.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <numeric>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace {
+    const std::string pieceLetters = "PNBRQK";
+
+    template<typename T>
+    T ReadLittleEndian(const unsigned char* bytes) {
+        T value;
+        std::memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+
+    // Blocks are only decompressed when a probe lands in them, and the last few are kept per thread
+    struct CachedBlock {
+        uint32_t generation = 0;
+        const void* table = nullptr;
+        uint32_t block = 0;
+        std::array<int8_t, TablebaseFormat::blockSize> entries;
+    };
+
+    thread_local std::array<CachedBlock, 16> blockCache;
+
+    // Bumped whenever tables are closed, so no thread trusts a block cached from an unmapped file
+    std::atomic<uint32_t> cacheGeneration = 1;
+
+    // The white king's place in the a1-d1-d4 triangle, -1 outside it
+    const std::array<int, 64> triangle = [] {
+        std::array<int, 64> slots{};
+        int slot = 0;
+        for (int square = 0; square < 64; ++square) slots[square] = square % 8 < 4 && square / 8 <= square % 8 ? slot++ : -1;
+        return slots;
+    }();
+    const int triangleSlots = 10;
+
+    bool IsPawn(int piece) { return (piece & 0b0111) == 1; }
+    int Transpose(int square) { return (square % 8) * 8 + square / 8; }
+}
+
+void TablebaseFormat::Sort(std::vector<int>& pieces, std::vector<int>& squares) {
+    auto rank = [](int piece) { return (piece >> 3) * 8 + 6 - (piece & 0b0111); };
+
+    std::vector<size_t> order(pieces.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return rank(pieces[a]) < rank(pieces[b]); });
+
+    std::vector<int> sortedPieces, sortedSquares;
+    for (size_t i : order) {
+        sortedPieces.push_back(pieces[i]);
+        if (i < squares.size()) sortedSquares.push_back(squares[i]);
+    }
+    pieces = sortedPieces;
+    if (!squares.empty()) squares = sortedSquares;
+}
+
+std::string TablebaseFormat::Signature(const std::vector<int>& pieces) {
+    std::string signature;
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        if (i > 0 && (pieces[i] >> 3) != (pieces[i - 1] >> 3)) signature += 'v';
+        signature += pieceLetters[(pieces[i] & 0b0111) - 1];
+    }
+    return signature;
+}
+
+bool TablebaseFormat::ParseSignature(const std::string& signature, std::vector<int>& pieces) {
+    size_t split = signature.find('v');
+    if (split == std::string::npos) return false;
+
+    pieces.clear();
+    int kings = 0;
+    for (size_t i = 0; i < signature.size(); ++i) {
+        if (i == split) continue;
+
+        size_t type = pieceLetters.find(signature[i]);
+        if (type == std::string::npos) return false;
+
+        int color = i > split ? 0b1000 : 0;
+        pieces.push_back(color | static_cast<int>(type + 1));
+        if (type + 1 == 6) ++kings;
+    }
+
+    // One king a side, each side's king named first
+    if (kings != 2 || signature[0] != 'K' || signature[split + 1] != 'K') return false;
+
+    std::vector<int> noSquares;
+    Sort(pieces, noSquares);
+    return true;
+}
+
+bool TablebaseFormat::HasPawns(const std::vector<int>& pieces) {
+    return std::any_of(pieces.begin(), pieces.end(), IsPawn);
+}
+
+uint64_t TablebaseFormat::EntryCount(const std::vector<int>& pieces) {
+    uint64_t count = 2 * (HasPawns(pieces) ? 32 : triangleSlots);
+    for (size_t i = 1; i < pieces.size(); ++i) count *= IsPawn(pieces[i]) ? 48 : 64;
+    return count;
+}
+
+void TablebaseFormat::Canonicalize(const std::vector<int>& pieces, std::vector<int>& squares) {
+    auto apply = [&squares](int (*transform)(int)) {
+        for (int& square : squares) square = transform(square);
+    };
+
+    if (squares[0] % 8 > 3) apply([](int square) { return square ^ 7; });
+    if (HasPawns(pieces)) return;
+
+    if (squares[0] / 8 > 3) apply([](int square) { return square ^ 56; });
+    if (squares[0] / 8 > squares[0] % 8) apply(Transpose);
+
+    if (squares[0] / 8 == squares[0] % 8) {
+        std::vector<int> transposed = squares;
+        for (int& square : transposed) square = Transpose(square);
+        if (Index(pieces, transposed, true) < Index(pieces, squares, true)) squares = transposed;
+    }
+}
+
+uint64_t TablebaseFormat::Index(const std::vector<int>& pieces, const std::vector<int>& squares, bool whiteToMove) {
+    bool pawns = HasPawns(pieces);
+    uint64_t index = pawns ? squares[0] / 8 * 4 + squares[0] % 8 : triangle[squares[0]];
+    uint64_t multiplier = pawns ? 32 : triangleSlots;
+    for (size_t i = 1; i < pieces.size(); ++i) {
+        index += static_cast<uint64_t>(IsPawn(pieces[i]) ? squares[i] - 8 : squares[i]) * multiplier;
+        multiplier *= IsPawn(pieces[i]) ? 48 : 64;
+    }
+    return 2 * index + (whiteToMove ? 0 : 1);
+}
+
+void TablebaseFormat::Decode(const std::vector<int>& pieces, uint64_t index, std::vector<int>& squares) {
+    static const std::array<int, triangleSlots> triangleSquares = [] {
+        std::array<int, triangleSlots> squares{};
+        for (int square = 0; square < 64; ++square) {
+            if (triangle[square] >= 0) squares[triangle[square]] = square;
+        }
+        return squares;
+    }();
+
+    bool pawns = HasPawns(pieces);
+    index /= 2;
+    squares[0] = pawns ? static_cast<int>(index % 32 / 4 * 8 + index % 4) : triangleSquares[index % triangleSlots];
+    index /= pawns ? 32 : triangleSlots;
+    for (size_t i = 1; i < pieces.size(); ++i) {
+        int radix = IsPawn(pieces[i]) ? 48 : 64;
+        squares[i] = static_cast<int>(index % radix) + (IsPawn(pieces[i]) ? 8 : 0);
+        index /= radix;
+    }
+}
+
+Tablebases::~Tablebases() {
+    Close();
+}
+
+int Tablebases::Init(const std::string& directory) {
+    Close();
+
+    std::error_code error;
+    for (const auto& file : std::filesystem::directory_iterator(directory, error)) {
+        if (file.path().extension() == TablebaseFormat::extension) Open(file.path().string());
+    }
+    return static_cast<int>(tables.size());
+}
+
+bool Tablebases::Open(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat fileInfo;
+    if (fstat(fd, &fileInfo) != 0 || fileInfo.st_size < 12) {
+        close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, fileInfo.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return false;
+
+    Table table;
+    table.mapping = static_cast<const unsigned char*>(mapping);
+    table.mappedSize = fileInfo.st_size;
+
+    // Check each field fits before reading it, a truncated file mustn't be trusted
+    const unsigned char* cursor = table.mapping;
+    const unsigned char* end = table.mapping + table.mappedSize;
+    auto fail = [&] {
+        munmap(mapping, table.mappedSize);
+        return false;
+    };
+
+    if (std::memcmp(cursor, TablebaseFormat::magic, 4) != 0) return fail();
+    if (ReadLittleEndian<uint32_t>(cursor + 4) != TablebaseFormat::version) return fail();
+    uint32_t pieceCount = ReadLittleEndian<uint32_t>(cursor + 8);
+    cursor += 12;
+
+    if (pieceCount < 2 || pieceCount > 10 || end - cursor < pieceCount + 16) return fail();
+    for (uint32_t i = 0; i < pieceCount; ++i) table.pieces.push_back(*cursor++);
+
+    if (ReadLittleEndian<uint32_t>(cursor) != TablebaseFormat::blockSize) return fail();
+    table.entryCount = ReadLittleEndian<uint64_t>(cursor + 4);
+    table.blockCount = ReadLittleEndian<uint32_t>(cursor + 12);
+    cursor += 16;
+
+    if (table.entryCount != TablebaseFormat::EntryCount(table.pieces) ||
+        table.blockCount != (table.entryCount + TablebaseFormat::blockSize - 1) / TablebaseFormat::blockSize ||
+        static_cast<size_t>(end - cursor) < (table.blockCount + 1) * sizeof(uint64_t)) {
+        return fail();
+    }
+    table.offsets = cursor;
+    table.blocks = cursor + (table.blockCount + 1) * sizeof(uint64_t);
+    table.blocksSize = ReadLittleEndian<uint64_t>(table.offsets + table.blockCount * sizeof(uint64_t));
+    if (table.blocksSize > static_cast<size_t>(end - table.blocks)) return fail();
+
+    // Squares are indexed in the file's piece order, which has to be the one probes sort into
+    std::vector<int> pieces = table.pieces, noSquares;
+    TablebaseFormat::Sort(pieces, noSquares);
+    if (pieces != table.pieces) return fail();
+
+    madvise(mapping, table.mappedSize, MADV_RANDOM);
+
+    std::string signature = TablebaseFormat::Signature(pieces);
+    auto existing = tables.find(signature);
+    if (existing != tables.end()) munmap(const_cast<unsigned char*>(existing->second.mapping), existing->second.mappedSize);
+    tables[signature] = table;
+
+    maxPieces = std::max(maxPieces, static_cast<int>(pieceCount));
+    return true;
+}
+
+void Tablebases::Close() {
+    for (auto& [signature, table] : tables) munmap(const_cast<unsigned char*>(table.mapping), table.mappedSize);
+    tables.clear();
+    maxPieces = 0;
+    ++cacheGeneration;
+}
+
+int Tablebases::ReadEntry(const Table& table, uint64_t index) const {
+    uint32_t block = static_cast<uint32_t>(index / TablebaseFormat::blockSize);
+    CachedBlock& cached = blockCache[(block ^ reinterpret_cast<uintptr_t>(&table) >> 4) % blockCache.size()];
+
+    uint32_t generation = cacheGeneration.load(std::memory_order_relaxed);
+    if (cached.generation != generation || cached.table != &table || cached.block != block) {
+        uint64_t start = ReadLittleEndian<uint64_t>(table.offsets + block * sizeof(uint64_t));
+        uint64_t finish = std::min(ReadLittleEndian<uint64_t>(table.offsets + (block + 1) * sizeof(uint64_t)),
+                                   table.blocksSize);
+
+        // PackBits: a control byte n >= 0 copies the next n + 1 bytes, n < 0 repeats the next byte 1 - n times
+        size_t filled = 0;
+        for (uint64_t position = start; position + 1 < finish && filled < cached.entries.size();) {
+            int control = static_cast<int8_t>(table.blocks[position++]);
+            if (control >= 0) {
+                size_t length = std::min<size_t>({static_cast<size_t>(control) + 1, cached.entries.size() - filled,
+                                                  finish - position});
+                std::memcpy(cached.entries.data() + filled, table.blocks + position, length);
+                filled += length;
+                position += control + 1;
+            } else if (control != -128) {
+                size_t length = std::min<size_t>(1 - control, cached.entries.size() - filled);
+                std::memset(cached.entries.data() + filled, table.blocks[position++], length);
+                filled += length;
+            }
+        }
+        std::memset(cached.entries.data() + filled, 0, cached.entries.size() - filled);
+
+        cached.generation = generation;
+        cached.table = &table;
+        cached.block = block;
+    }
+    return cached.entries[index % TablebaseFormat::blockSize];
+}
+
+bool Tablebases::ProbeMaterial(std::vector<int> pieces, std::vector<int> squares, bool whiteToMove, int& entry) const {
+    // Bare kings are a draw without needing a table
+    if (pieces.size() == 2) {
+        entry = 0;
+        return true;
+    }
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        TablebaseFormat::Sort(pieces, squares);
+
+        auto table = tables.find(TablebaseFormat::Signature(pieces));
+        if (table != tables.end()) {
+            TablebaseFormat::Canonicalize(pieces, squares);
+            entry = ReadEntry(table->second, TablebaseFormat::Index(pieces, squares, whiteToMove));
+            return true;
+        }
+
+        // Try the colours the other way round, mirroring the board so the sides keep their direction
+        for (int& piece : pieces) piece ^= 0b1000;
+        for (int& square : squares) square ^= 56;
+        whiteToMove = !whiteToMove;
+    }
+    return false;
+}
+
+bool Tablebases::Probe(const Gamestate& gamestate, int& wdl, int& dtz) const {
+    if (tables.empty() || bit_cnt(gamestate.all_pieces) > maxPieces) return false;
+    if (gamestate.legality & legalityBits::castleMask) return false;
+
+    // The tables are built as if no pawn could ever be taken en passant
+    if (gamestate.legality & legalityBits::enPassantLegalMask) {
+        int file = (gamestate.legality & legalityBits::enPassantFileMask) >> legalityBits::enPassantFileShift;
+        U64 neighbours = (file > 0 ? Board::Files::aFile << (file - 1) : 0) | (file < 7 ? Board::Files::aFile << (file + 1) : 0);
+        U64 capturers = gamestate.whiteToMove ? gamestate.w_pawn & Board::Ranks::rank_5 : gamestate.b_pawn & Board::Ranks::rank_4;
+        if (capturers & neighbours) return false;
+    }
+
+    std::vector<int> pieces, squares;
+    U64 occupied = gamestate.all_pieces;
+    while (occupied) {
+        int square = popLSB(occupied);
+        pieces.push_back(gamestate.mailbox[square]);
+        squares.push_back(square);
+    }
+
+    int entry;
+    if (!ProbeMaterial(pieces, squares, gamestate.whiteToMove, entry)) return false;
+
+    wdl = TablebaseFormat::WDL(entry);
+    dtz = TablebaseFormat::DTZ(entry);
+
+    // A result the fifty-move rule cuts off before the capture, promotion or mate is a draw
+    if (gamestate.halfmoveClock + dtz > 100) wdl = 0;
+    return true;
+}
+
+void Tablebases::FilterRootMoves(std::vector<Move>& moves) const {
+    Gamestate& gamestate = Gamestate::Get();
+    int wdl, dtz;
+    if (moves.empty() || !Probe(gamestate, wdl, dtz)) return;
+
+    // Mates first, then captures and promotions that keep the win, then the shortest distance to one.
+    // Losing, the longest resistance is best. Every draw is as good as another.
+    std::vector<int> ranks;
+    for (Move move : moves) {
+        gamestate.MakeMove(move);
+        bool mate = MoveGenerator::Get().GenerateLegalMoves().empty() && MoveGenerator::Get().king_is_in_check;
+        int childWdl = 0, childDtz = 0;
+        bool found = mate || Probe(gamestate, childWdl, childDtz);
+        gamestate.UndoMove();
+
+        // A conversion into a table that isn't there, or a push open to en passant, is left to the search
+        if (!found) return;
+
+        bool conversion = move.flag & (MoveFlags::capture | MoveFlags::promotion);
+        if (mate) ranks.push_back(3000);
+        else if (childWdl < 0) ranks.push_back(conversion ? 2000 : 1000 - childDtz);
+        else if (childWdl == 0) ranks.push_back(0);
+        else ranks.push_back(-1000 + childDtz);
+    }
+
+    int best = *std::max_element(ranks.begin(), ranks.end());
+    std::vector<Move> kept;
+    for (size_t i = 0; i < moves.size(); ++i) {
+        if (ranks[i] == best) kept.push_back(moves[i]);
+    }
+    moves = kept;
+}
@@ -0,0 +1,101 @@
+#ifndef CHESS_ENGINE_TABLEBASE_H
+#define CHESS_ENGINE_TABLEBASE_H
+
+#include "gamestate.h"
+#include "move.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// Each table file holds one byte per position of a material signature such as KRPvKR,
+// indexed by side to move and the square of every piece, in fixed size blocks that are
+// PackBits compressed. Layout, little endian:
+//
+//   "CETB" | version u32 | piece count u32 | piece numbers u8[] | block size u32 |
+//   entry count u64 | block count u32 | block offsets u64[block count + 1] | blocks
+//
+// Only one of each set of mirrored positions is stored: the white king is kept in the a1-d1-d4
+// triangle, or on the a to d files once there are pawns. Tools/TablebaseGen writes them.
+namespace TablebaseFormat {
+    const char magic[4] = {'C', 'E', 'T', 'B'};
+    const uint32_t version = 2;
+    const uint32_t blockSize = 4096;
+    const std::string extension = ".cetb";
+
+    // 0 is a draw, n > 0 a win that captures, promotes or mates within n plies and -n - 1
+    // a loss where the opponent needs n plies to do so
+    inline int WDL(int entry) { return (entry > 0) - (entry < 0); }
+    inline int DTZ(int entry) { return entry >= 0 ? entry : -entry - 1; }
+    inline int Win(int dtz) { return dtz; }
+    inline int Loss(int dtz) { return -dtz - 1; }
+
+    // White's pieces then black's, kings first, then queens, rooks, bishops, knights and pawns
+    void Sort(std::vector<int>& pieces, std::vector<int>& squares);
+    std::string Signature(const std::vector<int>& pieces);
+    bool ParseSignature(const std::string& signature, std::vector<int>& pieces);
+
+    bool HasPawns(const std::vector<int>& pieces);
+    uint64_t EntryCount(const std::vector<int>& pieces);
+
+    // Mirrors sorted squares into the stored part of the board. When the white king is on the
+    // diagonal either reflection is, and the one with the lower index is kept.
+    void Canonicalize(const std::vector<int>& pieces, std::vector<int>& squares);
+
+    // Side to move in the lowest bit, then the white king's place in the stored part of the
+    // board, then each other piece's square, counting pawns from a2 as they can't reach the edges
+    uint64_t Index(const std::vector<int>& pieces, const std::vector<int>& squares, bool whiteToMove);
+    void Decode(const std::vector<int>& pieces, uint64_t index, std::vector<int>& squares);
+}
+
+class Tablebases {
+private:
+    Tablebases() = default;
+    ~Tablebases();
+
+    struct Table {
+        std::vector<int> pieces;
+        const unsigned char* mapping = nullptr;
+        size_t mappedSize = 0;
+        uint64_t entryCount = 0;
+        uint32_t blockCount = 0;
+        const unsigned char* offsets = nullptr;
+        const unsigned char* blocks = nullptr;
+        uint64_t blocksSize = 0;
+    };
+
+    bool Open(const std::string& path);
+    int ReadEntry(const Table& table, uint64_t index) const;
+
+    std::unordered_map<std::string, Table> tables;
+    int maxPieces = 0;
+
+public:
+    static Tablebases& Get() {
+        static Tablebases instance;
+        return instance;
+    }
+
+    Tablebases(const Tablebases&) = delete;
+
+    // Maps every table in the directory and returns how many were found
+    int Init(const std::string& directory);
+    void Close();
+    int MaxPieces() const { return maxPieces; }
+
+    // Looks up pieces on squares in whichever colour order a table exists for.
+    // The entry is from the point of view of the side to move.
+    bool ProbeMaterial(std::vector<int> pieces, std::vector<int> squares, bool whiteToMove, int& entry) const;
+
+    // Positions with castling rights, or where an en passant capture is possible, aren't covered.
+    // Wins and losses that can't be converted before the halfmove clock reaches 100 count as draws.
+    bool Probe(const Gamestate& gamestate, int& wdl, int& dtz) const;
+
+    // Keeps only the root moves that hold the tablebase result, preferring the quickest
+    // way to convert a win, so the search can't drift around a won ending
+    void FilterRootMoves(std::vector<Move>& moves) const;
+};
+
+
+#endif //CHESS_ENGINE_TABLEBASE_H
@@ -9,87 +9,76 @@
 #include "Search.h"
 #include <iostream>
 #include <iomanip>
+#include <atomic>
+#include <thread>
+
+
+std::vector<MoveGenTest::PerftCase> MoveGenTest::PerftSuite(Level level) {
+    std::vector<PerftCase> suite;
+    for (int position = 0; position < 128; ++position) {
+        int depth = level == FullTest ? 6 : 5;
+        if (level == QuickTest) {
+            // The deepest count that stays under a million nodes
+            depth = 1;
+            while (depth < 6 && perftResults[position][depth] < 1000000) depth++;
+        }
+        suite.push_back({position, depth, static_cast<U64>(perftResults[position][depth - 1])});
+    }
+    return suite;
+}
 
-
-void MoveGenTest::TestPerft(Level level) {
-    Gamestate &gamestate = Gamestate::Get();
-    MoveGenerator &generator = MoveGenerator::Get();
-
-    std::vector<int> testPositions, testingDepths;
-    int numPositions, maxNodes, depth, position;
-    U64 totalTime = 0, totalNodes = 0, nodesFound;
-    switch(level) {
-        case QuickTest:
-            numPositions = 112;
-            maxNodes = 1000000; // 1 million
-
-            testPositions.reserve(numPositions);
-            testingDepths.reserve(numPositions);
-
-            while (testPositions.size() != numPositions) {
-                position = rand() % 128;
-                if (std::find(testPositions.begin(), testPositions.end(), position) != testPositions.end()) continue;
-                depth = 0;
-                while (perftResults[position][depth + 1] < maxNodes) {
-                    depth++;
-                    if (depth == 5) break;
-                }
-                testPositions.push_back(position);
-                testingDepths.push_back(depth);
-            }
-            break;
-
-        case StandardTest:
-        case FullTest:
-        default:
-            numPositions = 128;
-            depth = 5;
-
-            testPositions.reserve(numPositions);
-            testingDepths.reserve(numPositions);
-
-            for (position = 0; position < numPositions; ++position) {
-                testPositions.push_back(position);
-                testingDepths.push_back(depth);
-                if (position == 1) testingDepths.back() -= 1; // Test 2 at a depth of 6 has more nodes than the int type
+bool MoveGenTest::TestPerft(Level level) {
+    std::vector<PerftCase> suite = PerftSuite(level);
+
+    // Positions are shared out to one thread per core, each thread counting on its own position
+    std::vector<U64> nodesFound(suite.size());
+    std::vector<U64> durations(suite.size());
+    std::atomic<size_t> nextTest = 0;
+
+    auto testStart = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned thread = 0; thread < std::max(1u, std::thread::hardware_concurrency()); ++thread) {
+        workers.emplace_back([&] {
+            for (size_t test = nextTest++; test < suite.size(); test = nextTest++) {
+                Gamestate::Get().Seed(positions[suite[test].position]);
+
+                auto start = std::chrono::high_resolution_clock::now();
+                nodesFound[test] = MoveGenerator::Get().PerftTree(suite[test].depth);
+                auto stop = std::chrono::high_resolution_clock::now();
+                durations[test] = std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count();
             }
-            break;
-
+        });
     }
-    while (!testPositions.empty()) {
-        position = testPositions.front();
-        depth = testingDepths.front();
-
-        gamestate.Seed(positions[position]);
-
-        auto start = std::chrono::high_resolution_clock::now();
-        nodesFound = generator.PerftTree(depth + 1);
-        auto stop = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
-
-        totalNodes += nodesFound;
-        totalTime += duration.count();
-
-        OutputTestResult(nodesFound == perftResults[position][depth], float(duration.count()) / pow(10, 6), nodesFound, position, depth);
-
-        testPositions.erase(testPositions.begin());
-        testingDepths.erase(testingDepths.begin());
+    for (std::thread& worker : workers) worker.join();
+    auto testStop = std::chrono::high_resolution_clock::now();
+
+    U64 totalNodes = 0;
+    int failures = 0;
+    for (size_t test = 0; test < suite.size(); ++test) {
+        bool passed = nodesFound[test] == suite[test].expected;
+        if (!passed) failures++;
+        totalNodes += nodesFound[test];
+        OutputTestResult(passed, float(durations[test]) / pow(10, 6), nodesFound[test], suite[test]);
     }
-    std::cout << "Total Time: " << double(totalTime) / pow(10, 6) << " seconds" << std::endl;
-    std::cout << "Average NPS: " << double(totalNodes) / (double(totalTime) / pow(10, 6)) << std::endl;
+
+    double totalTime = std::chrono::duration<double>(testStop - testStart).count();
+    std::cout << std::setprecision(3) << "Total Time: " << totalTime << " seconds" << std::endl;
+    std::cout << "Average NPS: " << std::setprecision(0) << double(totalNodes) / totalTime << std::endl;
+    std::cout << failures << " of " << suite.size() << " tests failed" << std::endl;
+    return failures == 0;
 }
 
-void MoveGenTest::OutputTestResult(bool passed, float time, int nodes, int testNum, int depth) {
+void MoveGenTest::OutputTestResult(bool passed, float time, U64 nodes, const PerftCase& test) {
     using namespace std;
 
     string testResult = passed ? " passed" : " failed";
 
-    setprecision(3);
-    cout << "Test " << setw(3) << testNum + 1 << testResult << "    ";
+    cout << fixed << setprecision(3);
+    cout << "Test " << setw(3) << test.position + 1 << testResult << "    ";
     cout << setw(9) << time << " seconds    ";
-    cout << setw(9) << perftResults[testNum][depth] << " nodes expected    ";
+    cout << setw(9) << test.expected << " nodes expected    ";
     cout << setw(9) << nodes << " nodes found    ";
-    cout << setw(12) << float(nodes) / time << " NPS" << endl;
+    cout << setprecision(0) << setw(12) << nodes / max(time, 1e-6f) << " NPS" << endl;
 }
 
 void SearchTest::TestSearch() {
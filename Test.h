@@ -5,7 +5,9 @@
 #ifndef CHESS_ENGINE_TEST_H
 #define CHESS_ENGINE_TEST_H
 
+#include "bitUtils.h"
 #include <string>
+#include <vector>
 
 
 namespace MoveGenTest {
@@ -277,8 +279,19 @@ namespace MoveGenTest {
         FullTest,
     };
 
-    void TestPerft(Level level = QuickTest);
-    void OutputTestResult(bool passed, float time, int nodes, int testNum, int depth);
+    // A position of the table above and the number of plies to count it to
+    struct PerftCase {
+        int position;
+        int depth;
+        U64 expected;
+    };
+
+    // Quick counts every position to under a million nodes, standard to 5 plies and full to 6
+    std::vector<PerftCase> PerftSuite(Level level);
+
+    // True if every count matched
+    bool TestPerft(Level level = QuickTest);
+    void OutputTestResult(bool passed, float time, U64 nodes, const PerftCase& test);
 }
 
 namespace SearchTest {
@@ -0,0 +1,77 @@
+#include "TimeManager.h"
+#include <algorithm>
+#include <cmath>
+
+
+void TimeManager::StartSearch(const SearchLimits& searchLimits) {
+    start = std::chrono::steady_clock::now();
+    limits = searchLimits;
+    pondering = limits.ponder;
+    bestMoveChanges = 0;
+
+    if (pondering) {
+        optimalTime = softLimit = hardLimit = INT_MAX;
+        return;
+    }
+
+    if (limits.moveTime) {
+        optimalTime = softLimit = hardLimit = std::max(limits.moveTime - moveOverhead, 1);
+        return;
+    }
+
+    if (!limits.timeLeft) {
+        // A depth or node limit alone decides when the search ends
+        optimalTime = softLimit = hardLimit = limits.depth || limits.nodes ? INT_MAX : defaultMoveTime;
+        return;
+    }
+
+    int movesToGo = limits.movesToGo ? std::min(limits.movesToGo, 40) : 30;
+    int available = std::max(limits.timeLeft - moveOverhead, 1);
+
+    optimalTime = available / movesToGo + 3 * limits.increment / 4;
+    hardLimit = std::min(5 * optimalTime, available / 3);
+    optimalTime = std::min(optimalTime, hardLimit);
+    softLimit = optimalTime;
+}
+
+void TimeManager::PonderHit() {
+    // The opponent played the expected move, our clock starts running now
+    SearchLimits ponderLimits = limits;
+    ponderLimits.ponder = false;
+    StartSearch(ponderLimits);
+}
+
+int TimeManager::Elapsed() const {
+    return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count());
+}
+
+bool TimeManager::SoftLimitReached() const {
+    return Elapsed() >= softLimit;
+}
+
+bool TimeManager::HardLimitReached() const {
+    return Elapsed() >= hardLimit;
+}
+
+bool TimeManager::CanStartIteration(int lastIterationTime, int plies) const {
+    if (SoftLimitReached()) return false;
+
+    // Don't begin an iteration that is expected to be cut off by the hard limit
+    double predicted = lastIterationTime * std::pow(plyBranchingFactor, plies);
+    return Elapsed() + predicted < hardLimit;
+}
+
+void TimeManager::ReportIteration(bool bestMoveChanged) {
+    // An unstable best move earns extra time, a stable one slowly gives it back
+    if (bestMoveChanged) {
+        ++bestMoveChanges;
+    } else if (bestMoveChanges > 0) {
+        --bestMoveChanges;
+    }
+
+    if (optimalTime == hardLimit) return;
+
+    long extended = static_cast<long>(optimalTime) * (4 + 2 * bestMoveChanges) / 4;
+    softLimit = static_cast<int>(std::min<long>(extended, hardLimit));
+}
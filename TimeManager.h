@@ -0,0 +1,49 @@
+#ifndef CHESS_ENGINE_TIMEMANAGER_H
+#define CHESS_ENGINE_TIMEMANAGER_H
+
+#include <chrono>
+#include <climits>
+
+
+struct SearchLimits {
+    int timeLeft = 0;    // ms on our clock, 0 if the game is untimed
+    int increment = 0;   // ms added after every move
+    int movesToGo = 0;   // moves until the next time control, 0 for sudden death
+    int moveTime = 0;    // fixed ms per move, overrides the clock when set
+    bool ponder = false; // search on the opponent's time until PonderHit
+    int depth = 0;       // plies, 0 for no limit
+    long long nodes = 0; // 0 for no limit
+    int multiPV = 1;     // best root moves to find exact scores for
+};
+
+class TimeManager {
+private:
+    std::chrono::steady_clock::time_point start;
+    SearchLimits limits;
+    bool pondering = false;
+
+    int softLimit = INT_MAX;
+    int hardLimit = INT_MAX;
+    int optimalTime = INT_MAX;
+
+    int bestMoveChanges = 0;
+
+    const int defaultMoveTime = 1000; // ms, used when no limits are given
+    const int moveOverhead = 30;      // ms lost to the GUI between moves
+    const double plyBranchingFactor = 2.45; // growth of the search time per ply of depth
+
+public:
+    void StartSearch(const SearchLimits& searchLimits);
+    void PonderHit();
+    bool IsPondering() const { return pondering; }
+
+    int Elapsed() const;
+    bool SoftLimitReached() const;
+    bool HardLimitReached() const;
+    bool CanStartIteration(int lastIterationTime, int plies) const;
+
+    void ReportIteration(bool bestMoveChanged);
+};
+
+
+#endif //CHESS_ENGINE_TIMEMANAGER_H
@@ -0,0 +1,273 @@
+// Analyses every position of an EPD or FEN file without the GUI and writes one JSON object per line:
+//
+//   Analyze [-depth N] [-nodes N] [-movetime ms] [-multipv N] [-threads N] [-hash MB]
+//           [-params "name=value,..."] [-stats] [-o out.jsonl] positions.epd
+//
+// Positions are handed out to a pool of worker threads, each with its own gamestate and search,
+// while the transposition table is shared between them. Results are written in input order.
+// A "bm" or "am" operation in the EPD is checked against the best move, so test suites can be scored.
+// With -multipv the best few moves are listed under "lines", each with its score and PV.
+// With -stats each result carries the search's counters, and their totals are printed at the end.
+// A build with ENABLE_PROFILING also prints where the cycles went.
+
+#include "gamestate.h"
+#include "movegen.h"
+#include "move.h"
+#include "Search.h"
+#include "evaluation.h"
+#include "NNUE.h"
+#include "Bitbase.h"
+#include "Tablebase.h"
+#include "Parameters.h"
+#include "SearchStats.h"
+#include "Profile.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+struct Options {
+    SearchLimits limits;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    int hash = 256; // MB
+    Parameters parameters;
+    bool stats = false;
+    std::string input;
+    std::string output;
+};
+
+struct Position {
+    std::string fen;
+    std::string id;
+    std::vector<std::string> bestMoves, avoidMoves; // SAN, as EPD writes them
+};
+
+std::string JSONString(const std::string& text) {
+    std::string escaped = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        escaped += c;
+    }
+    return escaped + "\"";
+}
+
+std::string UCINotation(Move move) {
+    if (move.flag == MoveFlags::nullMove) return "0000";
+
+    std::string notation = AlgebraicNotation(move);
+    if (move.flag >= MoveFlags::knightPromotion) notation += "nbrq"[move.flag & 0b11];
+    return notation;
+}
+
+// EPD lines are the first four FEN fields followed by "opcode operands;" operations.
+// Plain FENs with move counters are accepted too.
+bool ParsePosition(const std::string& line, Position& position) {
+    std::istringstream stream(line);
+    std::vector<std::string> fields(4);
+    for (std::string& field : fields) {
+        if (!(stream >> field)) return false;
+    }
+
+    std::string rest;
+    std::getline(stream, rest);
+    std::istringstream counters(rest);
+    std::string halfmoves, fullmoves;
+    if (counters >> halfmoves >> fullmoves && std::isdigit(static_cast<unsigned char>(halfmoves[0])) &&
+        std::isdigit(static_cast<unsigned char>(fullmoves[0]))) {
+        std::getline(counters, rest);
+    } else {
+        halfmoves = "0";
+        fullmoves = "1";
+    }
+    position.fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3] + " " + halfmoves + " " + fullmoves;
+
+    std::istringstream operations(rest);
+    std::string operation;
+    while (std::getline(operations, operation, ';')) {
+        std::istringstream words(operation);
+        std::string opcode, operand;
+        if (!(words >> opcode)) continue;
+
+        if (opcode == "id") {
+            std::getline(words >> std::ws, operand);
+            if (operand.size() >= 2 && operand.front() == '"' && operand.back() == '"') {
+                operand = operand.substr(1, operand.size() - 2);
+            }
+            position.id = operand;
+        } else if (opcode == "bm" || opcode == "am") {
+            while (words >> operand) (opcode == "bm" ? position.bestMoves : position.avoidMoves).push_back(operand);
+        }
+    }
+    return true;
+}
+
+bool MatchesAny(const std::vector<std::string>& sanMoves, Move move) {
+    for (const std::string& san : sanMoves) {
+        Move candidate;
+        if (ParseSAN(san, candidate) && candidate.startSquare == move.startSquare &&
+            candidate.endSquare == move.endSquare && candidate.flag == move.flag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Scores are from the side to move's point of view
+std::string ScoreJSON(int eval) {
+    if (isMateEval(eval)) {
+        int plies = INT32_MAX - std::abs(eval);
+        return "\"mate\":" + std::to_string(eval > 0 ? (plies + 1) / 2 : -(plies + 1) / 2);
+    }
+    return "\"score\":" + std::to_string(eval);
+}
+
+std::string MovesJSON(const std::vector<Move>& moves) {
+    std::string json = "[";
+    for (size_t ply = 0; ply < moves.size(); ++ply) json += (ply ? "," : "") + JSONString(UCINotation(moves[ply]));
+    return json + "]";
+}
+
+std::string Analyse(const Position& position, const Options& options, size_t line) {
+    Gamestate& gamestate = Gamestate::Get();
+    gamestate.Seed(position.fen);
+
+    MovePicker& picker = MovePicker::Get();
+    auto start = std::chrono::steady_clock::now();
+    picker.InitSearch(options.limits);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    std::ostringstream json;
+    json << "{\"line\":" << line;
+    if (!position.id.empty()) json << ",\"id\":" << JSONString(position.id);
+    json << ",\"fen\":" << JSONString(position.fen);
+    json << ",\"bestmove\":" << JSONString(UCINotation(picker.bestMove));
+    json << "," << ScoreJSON(picker.bestEval);
+    json << ",\"depth\":" << picker.completedDepth << ",\"nodes\":" << picker.Nodes() << ",\"time\":" << elapsed.count();
+    json << ",\"pv\":" << MovesJSON(picker.principalVariation);
+
+    if (options.limits.multiPV > 1) {
+        json << ",\"lines\":[";
+        for (size_t i = 0; i < picker.lines.size(); ++i) {
+            const SearchLine& searchLine = picker.lines[i];
+            json << (i ? "," : "") << "{\"move\":" << JSONString(UCINotation(searchLine.move)) << ","
+                 << ScoreJSON(searchLine.eval) << ",\"pv\":" << MovesJSON(searchLine.pv) << "}";
+        }
+        json << "]";
+    }
+
+    if (!position.bestMoves.empty() || !position.avoidMoves.empty()) {
+        bool solved = (position.bestMoves.empty() || MatchesAny(position.bestMoves, picker.bestMove)) &&
+                      !MatchesAny(position.avoidMoves, picker.bestMove);
+        json << ",\"solved\":" << (solved ? "true" : "false");
+    }
+    if (options.stats) json << ",\"stats\":" << SearchStats::Get().ToJSON();
+    json << "}";
+    return json.str();
+}
+
+bool ParseArguments(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (argument == "-depth" && hasValue) options.limits.depth = std::stoi(argv[++i]);
+        else if (argument == "-nodes" && hasValue) options.limits.nodes = std::stoll(argv[++i]);
+        else if (argument == "-movetime" && hasValue) options.limits.moveTime = std::stoi(argv[++i]);
+        else if (argument == "-multipv" && hasValue) options.limits.multiPV = std::max(1, std::stoi(argv[++i]));
+        else if (argument == "-threads" && hasValue) options.threads = std::max(1, std::stoi(argv[++i]));
+        else if (argument == "-hash" && hasValue) options.hash = std::max(1, std::stoi(argv[++i]));
+        else if (argument == "-params" && hasValue) {
+            if (!options.parameters.Apply(argv[++i])) return false;
+        }
+        else if (argument == "-stats") options.stats = true;
+        else if (argument == "-o" && hasValue) options.output = argv[++i];
+        else if (argument[0] == '-' || !options.input.empty()) return false;
+        else options.input = argument;
+    }
+    return !options.input.empty();
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseArguments(argc, argv, options)) {
+        std::cerr << "usage: Analyze [-depth N] [-nodes N] [-movetime ms] [-multipv N] [-threads N] [-hash MB] "
+                     "[-params name=value,...] [-stats] [-o out.jsonl] positions.epd\n"
+                     "parameters: " << Parameters().ToString() << std::endl;
+        return 1;
+    }
+
+    std::ifstream input(options.input);
+    if (!input) {
+        std::cerr << "can't read " << options.input << std::endl;
+        return 1;
+    }
+
+    std::ofstream outputFile;
+    if (!options.output.empty()) outputFile.open(options.output);
+    std::ostream& output = options.output.empty() ? std::cout : outputFile;
+
+    MovementTables::LoadTables();
+    NNUENetwork::Get().Load("nnue.bin");
+    Bitbases::Get().Init("bitbases.bin");
+    Tablebases::Get().Init("tablebases");
+    TranspositionTable::Get().Resize(options.hash);
+
+    std::mutex inputMutex, outputMutex;
+    size_t nextIndex = 0, nextToWrite = 0;
+    std::map<size_t, std::string> finished; // waiting for an earlier position to be written
+    std::atomic<long> analysed = 0, skipped = 0;
+    SearchStats totals;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int thread = 0; thread < options.threads; ++thread) {
+        workers.emplace_back([&] {
+            Parameters::Get() = options.parameters;
+            while (true) {
+                std::string line;
+                size_t index;
+                {
+                    std::lock_guard<std::mutex> lock(inputMutex);
+                    if (!std::getline(input, line)) return;
+                    index = nextIndex++;
+                }
+
+                Position position;
+                std::string result;
+                if (!line.empty() && line[0] != '#' && ParsePosition(line, position)) {
+                    result = Analyse(position, options, index + 1);
+                    ++analysed;
+                } else {
+                    ++skipped;
+                }
+
+                std::lock_guard<std::mutex> lock(outputMutex);
+                if (!result.empty()) totals.Merge(SearchStats::Get());
+                finished[index] = result;
+                for (auto next = finished.begin(); next != finished.end() && next->first == nextToWrite;
+                     next = finished.erase(next), ++nextToWrite) {
+                    if (!next->second.empty()) output << next->second << '\n';
+                }
+            }
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+    output.flush();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cerr << analysed << " positions analysed, " << skipped << " lines skipped in "
+              << elapsed.count() << " ms" << std::endl;
+    if (options.stats) std::cerr << totals.ToJSON() << std::endl;
+    if (Profile::enabled) std::cerr << Profile::Report();
+    return 0;
+}
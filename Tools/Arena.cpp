@@ -0,0 +1,176 @@
+// Plays the engine against itself with two parameter sets, many games at once, and runs a
+// sequential probability ratio test on the results as they come in:
+//
+//   Arena [-games N] [-concurrency N] [-tc base+inc | -movetime ms | -nodes N | -depth N] [-hash MB]
+//         [-a "name=value,..."] [-b "name=value,..."] [-elo0 E] [-elo1 E] [-alpha A] [-beta B]
+//         [openings.epd]
+//
+// Every opening is played twice with the colours swapped. Each worker thread plays whole games,
+// switching its parameters to whichever side is to move, while the transposition table and the
+// evaluation cache are shared and keyed by parameter set. The match stops once the test accepts
+// either hypothesis: H0 that B is elo0 stronger than A, or H1 that it is elo1 stronger.
+
+#include "gamestate.h"
+#include "Search.h"
+#include "NNUE.h"
+#include "Bitbase.h"
+#include "Tablebase.h"
+#include "Parameters.h"
+#include "SelfPlay.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+struct Options {
+    SearchLimits limits;
+    int games = 1000;
+    int concurrency = std::max(1u, std::thread::hardware_concurrency());
+    int hash = 64; // MB
+    std::string openings;
+    Parameters a, b;
+    double elo0 = 0, elo1 = 5, alpha = 0.05, beta = 0.05;
+};
+
+// Wins, draws and losses of B against A, with the log likelihood ratio of the normal approximation
+struct Tally {
+    int wins = 0, draws = 0, losses = 0;
+
+    int Games() const { return wins + draws + losses; }
+    double Score() const { return (wins + draws / 2.0) / Games(); }
+
+    // Counts one virtual win and one virtual loss besides the real games, so the spread is never
+    // zero and a match where every game had the same result still reaches a decision
+    double Variance() const {
+        double games = Games() + 2, score = (wins + 1 + draws / 2.0) / games;
+        return ((wins + 1) * std::pow(1 - score, 2) + draws * std::pow(0.5 - score, 2) +
+                (losses + 1) * std::pow(score, 2)) / games;
+    }
+
+    double LLR(double elo0, double elo1) const {
+        // Too few games say nothing about the spread yet
+        if (Games() < 2) return 0;
+
+        auto expected = [](double elo) { return 1 / (1 + std::pow(10, -elo / 400)); };
+        double s0 = expected(elo0), s1 = expected(elo1);
+        return Games() * (s1 - s0) * (2 * Score() - s0 - s1) / (2 * Variance());
+    }
+
+    // Elo difference and the half width of its 95% interval
+    void Elo(double& elo, double& margin) const {
+        auto toElo = [](double score) {
+            score = std::clamp(score, 1e-6, 1 - 1e-6);
+            return -400 * std::log10(1 / score - 1);
+        };
+        double deviation = std::sqrt(Variance() / Games());
+        elo = toElo(Score());
+        margin = (toElo(Score() + 1.96 * deviation) - toElo(Score() - 1.96 * deviation)) / 2;
+    }
+};
+
+bool ParseArguments(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (argument == "-games" && hasValue) options.games = std::max(1, std::stoi(argv[++i]));
+        else if (argument == "-concurrency" && hasValue) options.concurrency = std::max(1, std::stoi(argv[++i]));
+        else if (argument == "-hash" && hasValue) options.hash = std::max(1, std::stoi(argv[++i]));
+        else if (hasValue && SelfPlay::ParseLimit(argument, argv[i + 1], options.limits)) ++i;
+        else if (argument == "-a" && hasValue) {
+            if (!options.a.Apply(argv[++i])) return false;
+        }
+        else if (argument == "-b" && hasValue) {
+            if (!options.b.Apply(argv[++i])) return false;
+        }
+        else if (argument == "-elo0" && hasValue) options.elo0 = std::stod(argv[++i]);
+        else if (argument == "-elo1" && hasValue) options.elo1 = std::stod(argv[++i]);
+        else if (argument == "-alpha" && hasValue) options.alpha = std::stod(argv[++i]);
+        else if (argument == "-beta" && hasValue) options.beta = std::stod(argv[++i]);
+        else if (argument[0] == '-' || !options.openings.empty()) return false;
+        else options.openings = argument;
+    }
+
+    SelfPlay::DefaultLimit(options.limits);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseArguments(argc, argv, options)) {
+        std::cerr << "usage: Arena [-games N] [-concurrency N] [-tc base+inc | -movetime ms | -nodes N | -depth N] "
+                     "[-hash MB] [-a params] [-b params] [-elo0 E] [-elo1 E] [-alpha A] [-beta B] [openings.epd]\n"
+                     "parameters: " << Parameters().ToString() << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> openings;
+    if (!options.openings.empty()) {
+        openings = SelfPlay::ReadOpenings(options.openings);
+        if (openings.empty()) {
+            std::cerr << "no positions in " << options.openings << std::endl;
+            return 1;
+        }
+    } else {
+        std::cerr << "no openings given, every pair starts from the initial position" << std::endl;
+        openings.push_back(SelfPlay::startingFen);
+    }
+
+    MovementTables::LoadTables();
+    NNUENetwork::Get().Load("nnue.bin");
+    Bitbases::Get().Init("bitbases.bin");
+    Tablebases::Get().Init("tablebases");
+    TranspositionTable::Get().Resize(options.hash);
+
+    std::cout << "A: " << options.a.ToString() << "\nB: " << options.b.ToString() << std::endl;
+
+    const double lowerBound = std::log(options.beta / (1 - options.alpha));
+    const double upperBound = std::log((1 - options.beta) / options.alpha);
+
+    std::mutex tallyMutex;
+    Tally tally;
+    std::atomic<int> nextGame = 0;
+    std::atomic<bool> decided = false;
+
+    std::vector<std::thread> workers;
+    for (int thread = 0; thread < options.concurrency; ++thread) {
+        workers.emplace_back([&] {
+            while (!decided) {
+                int game = nextGame++;
+                if (game >= options.games) return;
+
+                const std::string& opening = openings[(game / 2) % openings.size()];
+                bool bIsWhite = game % 2 == 1;
+                SelfPlay::Outcome outcome = bIsWhite ? SelfPlay::PlayGame(opening, options.b, options.a, options.limits)
+                                                     : SelfPlay::PlayGame(opening, options.a, options.b, options.limits);
+
+                std::lock_guard<std::mutex> lock(tallyMutex);
+                if (outcome == SelfPlay::Outcome::Drawn) ++tally.draws;
+                else if ((outcome == SelfPlay::Outcome::WhiteWins) == bIsWhite) ++tally.wins;
+                else ++tally.losses;
+
+                double elo, margin, llr = tally.LLR(options.elo0, options.elo1);
+                tally.Elo(elo, margin);
+                std::cout << std::fixed << std::setprecision(2) << "games " << tally.Games() << "  B +"
+                          << tally.wins << " =" << tally.draws << " -" << tally.losses << "  elo " << elo
+                          << " +- " << margin << "  LLR " << llr << " [" << lowerBound << ", " << upperBound
+                          << "]" << std::endl;
+
+                if (llr <= lowerBound || llr >= upperBound) decided = true;
+            }
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+
+    double llr = tally.LLR(options.elo0, options.elo1);
+    if (llr >= upperBound) std::cout << "H1 accepted: B is stronger" << std::endl;
+    else if (llr <= lowerBound) std::cout << "H0 accepted: B is not stronger" << std::endl;
+    else std::cout << "no decision after " << tally.Games() << " games" << std::endl;
+    return 0;
+}
@@ -0,0 +1,207 @@
+// Times the engine's primitives one at a time over the perft suite's 128 positions:
+//
+//   Bench [-warmup N] [-repetitions N] [-filter name] [-o results.jsonl]
+//
+// Every repetition is one pass over the positions, and the time of a pass divided by the
+// operations it did is one sample. Setting up each position is kept out of the timing.
+// The summary of the samples is written as one JSON object per primitive, so two commits'
+// results can be diffed, and as a table on stderr. A build with ENABLE_PROFILING adds the
+// hot path breakdown of a fixed depth search over the same positions.
+
+#include "gamestate.h"
+#include "movegen.h"
+#include "evaluation.h"
+#include "Search.h"
+#include "Zobrist.h"
+#include "EvalCache.h"
+#include "Test.h"
+#include "Profile.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+
+struct Options {
+    int warmup = 2;
+    int repetitions = 10;
+    std::string filter;
+    std::string output;
+};
+
+struct Summary {
+    std::string name;
+    uint64_t operations = 0; // per pass
+    double mean = 0, median = 0, deviation = 0, fastest = 0; // ns per operation
+};
+
+// Runs once per position: setup is untimed, the body returns how many operations it did
+struct Primitive {
+    std::string name;
+    std::function<void()> beforePass;
+    std::function<void(const std::string& fen)> setup;
+    std::function<uint64_t(const std::string& fen)> body;
+};
+
+const int innerRepeats = 16; // repeats of cheap operations per position, so clock reads don't dominate
+
+Summary Measure(const Primitive& primitive, const Options& options) {
+    std::vector<double> samples;
+    uint64_t operations = 0;
+
+    for (int pass = 0; pass < options.warmup + options.repetitions; ++pass) {
+        if (primitive.beforePass) primitive.beforePass();
+
+        std::chrono::nanoseconds elapsed(0);
+        operations = 0;
+        for (const std::string& fen : MoveGenTest::positions) {
+            primitive.setup(fen);
+            auto start = std::chrono::steady_clock::now();
+            operations += primitive.body(fen);
+            elapsed += std::chrono::steady_clock::now() - start;
+        }
+        if (pass >= options.warmup) samples.push_back(static_cast<double>(elapsed.count()) / operations);
+    }
+
+    Summary summary;
+    summary.name = primitive.name;
+    summary.operations = operations;
+    summary.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    summary.fastest = *std::min_element(samples.begin(), samples.end());
+
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    size_t middle = sorted.size() / 2;
+    summary.median = sorted.size() % 2 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2;
+
+    double squares = 0;
+    for (double sample : samples) squares += (sample - summary.mean) * (sample - summary.mean);
+    summary.deviation = samples.size() > 1 ? std::sqrt(squares / (samples.size() - 1)) : 0;
+    return summary;
+}
+
+std::vector<Primitive> Primitives() {
+    Gamestate& gamestate = Gamestate::Get();
+    MoveGenerator& moveGenerator = MoveGenerator::Get();
+    static std::vector<Move> moves;
+
+    auto seed = [&](const std::string& fen) { gamestate.Seed(fen); };
+    auto seedWithMoves = [&](const std::string& fen) {
+        gamestate.Seed(fen);
+        moves = moveGenerator.GenerateLegalMoves();
+    };
+
+    auto repeat = [](std::function<void()> operation) {
+        return [operation](const std::string&) {
+            for (int i = 0; i < innerRepeats; ++i) operation();
+            return static_cast<uint64_t>(innerRepeats);
+        };
+    };
+
+    return {
+            {"MakeUndoMove", nullptr, seedWithMoves, [&](const std::string&) {
+                for (int i = 0; i < innerRepeats; ++i) {
+                    for (Move move : moves) {
+                        gamestate.MakeMove(move);
+                        gamestate.UndoMove();
+                    }
+                }
+                return static_cast<uint64_t>(innerRepeats * moves.size());
+            }},
+            // Forgetting the enemy's attacks makes every call work them out, as a new position would
+            {"GenerateLegalMoves", nullptr, seed, repeat([&] {
+                moveGenerator.enemyAttacksKey = 0;
+                moveGenerator.GenerateLegalMoves();
+            })},
+            {"GenerateCaptures", nullptr, seed, repeat([&] {
+                moveGenerator.enemyAttacksKey = 0;
+                moveGenerator.GenerateLegalMoves(true);
+            })},
+            {"CalculateEnemyAttacks", nullptr, seedWithMoves, repeat([&] { moveGenerator.CalculateEnemyAttacks(); })},
+            {"CalculatePinMasks", nullptr, seedWithMoves, repeat([&] { moveGenerator.CalculatePinMasks(); })},
+
+            // Cleared before every pass so each position is evaluated rather than found in the cache
+            {"StaticEvaluation", [] { EvalCache::Get().Clear(); }, seed, [](const std::string&) {
+                Evaluator::Get().StaticEvaluation();
+                return static_cast<uint64_t>(1);
+            }},
+            {"GenerateKey", nullptr, seed, repeat([] { Zobrist::Get().GenerateKey(); })},
+            {"TTStore", nullptr, seedWithMoves, repeat([&] {
+                TranspositionTable::Get().StorePosition(4, 0, 0, Exact, moves.empty() ? Move() : moves[0]);
+            })},
+            {"TTLookup", nullptr, seedWithMoves, [&](const std::string&) {
+                TranspositionTable::Get().StorePosition(4, 0, 0, Exact, moves.empty() ? Move() : moves[0]);
+                for (int i = 0; i < innerRepeats; ++i) TranspositionTable::Get().Lookup(4, 0, -Infinity, Infinity);
+                return static_cast<uint64_t>(innerRepeats);
+            }},
+            {"Seed", nullptr, [](const std::string&) {}, [&](const std::string& fen) {
+                for (int i = 0; i < innerRepeats; ++i) gamestate.Seed(fen);
+                return static_cast<uint64_t>(innerRepeats);
+            }},
+    };
+}
+
+bool ParseArguments(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (argument == "-warmup" && hasValue) options.warmup = std::max(0, std::stoi(argv[++i]));
+        else if (argument == "-repetitions" && hasValue) options.repetitions = std::max(1, std::stoi(argv[++i]));
+        else if (argument == "-filter" && hasValue) options.filter = argv[++i];
+        else if (argument == "-o" && hasValue) options.output = argv[++i];
+        else return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseArguments(argc, argv, options)) {
+        std::cerr << "usage: Bench [-warmup N] [-repetitions N] [-filter name] [-o results.jsonl]" << std::endl;
+        return 1;
+    }
+
+    std::ofstream outputFile;
+    if (!options.output.empty()) outputFile.open(options.output);
+    std::ostream& output = options.output.empty() ? std::cout : outputFile;
+
+    MovementTables::LoadTables();
+    TranspositionTable::Get().Resize(64);
+
+    std::cerr << std::left << std::setw(24) << "primitive" << std::right << std::setw(12) << "ops/pass"
+              << std::setw(12) << "mean ns" << std::setw(12) << "median" << std::setw(12) << "stddev"
+              << std::setw(12) << "min" << std::endl;
+
+    for (const Primitive& primitive : Primitives()) {
+        if (!options.filter.empty() && primitive.name.find(options.filter) == std::string::npos) continue;
+
+        Summary summary = Measure(primitive, options);
+        output << std::fixed << std::setprecision(2) << "{\"name\":\"" << summary.name << "\",\"operations\":"
+               << summary.operations << ",\"mean\":" << summary.mean << ",\"median\":" << summary.median
+               << ",\"stddev\":" << summary.deviation << ",\"min\":" << summary.fastest << "}" << std::endl;
+        std::cerr << std::left << std::setw(24) << summary.name << std::right << std::setw(12) << summary.operations
+                  << std::fixed << std::setprecision(1) << std::setw(12) << summary.mean << std::setw(12)
+                  << summary.median << std::setw(12) << summary.deviation << std::setw(12) << summary.fastest
+                  << std::endl;
+    }
+
+    if (Profile::enabled) {
+        Profile::Reset();
+        SearchLimits limits;
+        limits.depth = 4;
+        for (const std::string& fen : MoveGenTest::positions) {
+            Gamestate::Get().Seed(fen);
+            MovePicker::Get().InitSearch(limits);
+        }
+        output << "{\"name\":\"profile\",\"sections\":" << Profile::ToJSON() << "}" << std::endl;
+        std::cerr << Profile::Report();
+    }
+    return 0;
+}
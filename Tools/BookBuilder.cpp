@@ -0,0 +1,329 @@
+// Builds an opening book in the format OpeningBook reads from PGN files:
+//
+//   BookBuilder [-o book.bin] [-ply 24] [-min 3] [-mem 512] [-threads N] games.pgn...
+//
+// Each input file is a shard handled by one worker thread at a time. Positions are buffered
+// until the thread's share of the memory budget (in MB) is used up, then sorted, tallied and
+// spilled to a run file. The runs are merged into the book at the end, so memory use stays
+// bounded however many games the inputs hold.
+
+#include "gamestate.h"
+#include "movegen.h"
+#include "move.h"
+#include "Book.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+struct Options {
+    std::string output = "book.bin";
+    int maxPly = 24;
+    int minGames = 3;
+    size_t memory = 512; // MB
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> inputs;
+};
+
+enum MoverResult : uint8_t {Loss, DrawResult, Win};
+
+struct Occurrence {
+    U64 key;
+    uint16_t move;
+    uint8_t result; // for the side that played the move
+};
+
+struct Tally {
+    U64 key;
+    uint16_t move;
+    uint32_t wins = 0, draws = 0, losses = 0;
+};
+
+bool operator<(const Tally& a, const Tally& b) {
+    return a.key != b.key ? a.key < b.key : a.move < b.move;
+}
+
+class RunWriter {
+private:
+    const std::string prefix;
+    std::vector<Occurrence> buffer;
+    size_t capacity;
+    int runCount = 0;
+
+    std::vector<std::string>& runs;
+    std::mutex& runsMutex;
+
+public:
+    RunWriter(std::string runPrefix, size_t bytes, std::vector<std::string>& runFiles, std::mutex& mutex)
+            : prefix(std::move(runPrefix)), capacity(std::max<size_t>(bytes / sizeof(Occurrence), 1024)),
+              runs(runFiles), runsMutex(mutex) {
+        buffer.reserve(capacity);
+    }
+
+    void Add(U64 key, uint16_t move, uint8_t result) {
+        buffer.push_back({key, move, result});
+        if (buffer.size() == capacity) Flush();
+    }
+
+    void Flush() {
+        if (buffer.empty()) return;
+
+        std::sort(buffer.begin(), buffer.end(), [](const Occurrence& a, const Occurrence& b) {
+            return a.key != b.key ? a.key < b.key : a.move < b.move;
+        });
+
+        std::string path = prefix + std::to_string(runCount++);
+        std::ofstream file(path, std::ios::binary);
+
+        for (size_t i = 0; i < buffer.size();) {
+            Tally tally;
+            tally.key = buffer[i].key;
+            tally.move = buffer[i].move;
+            for (; i < buffer.size() && buffer[i].key == tally.key && buffer[i].move == tally.move; ++i) {
+                if (buffer[i].result == Win) ++tally.wins;
+                else if (buffer[i].result == DrawResult) ++tally.draws;
+                else ++tally.losses;
+            }
+            file.write(reinterpret_cast<const char*>(&tally), sizeof(tally));
+        }
+        buffer.clear();
+
+        std::lock_guard<std::mutex> lock(runsMutex);
+        runs.push_back(path);
+    }
+};
+
+class PGNReader {
+private:
+    const Options& options;
+    RunWriter& writer;
+
+    std::string fen;
+    std::string movetext;
+    int whiteResult = -1;
+    bool inComment = false; // inside a {} comment that spans lines
+
+    void ReplayGame() {
+        Gamestate& gamestate = Gamestate::Get();
+        OpeningBook& book = OpeningBook::Get();
+        gamestate.Seed(fen.empty() ? "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1" : fen);
+
+        int ply = 0, depth = 0;
+        size_t i = 0;
+        while (i < movetext.size() && ply < options.maxPly) {
+            char c = movetext[i];
+
+            // Comments, variations and annotations don't change the game
+            if (c == '{') {
+                i = movetext.find('}', i);
+                if (i == std::string::npos) return;
+                ++i;
+                continue;
+            }
+            if (c == '(') ++depth;
+            if (c == ')') --depth;
+            if (std::isspace(static_cast<unsigned char>(c)) || c == '(' || c == ')' || depth > 0) {
+                ++i;
+                continue;
+            }
+
+            size_t end = i;
+            while (end < movetext.size() && !std::isspace(static_cast<unsigned char>(movetext[end])) &&
+                   movetext[end] != '{' && movetext[end] != '(' && movetext[end] != ')') {
+                ++end;
+            }
+            std::string token = movetext.substr(i, end - i);
+            i = end;
+
+            // Move numbers may be glued to the move, as in "1.e4"
+            size_t dots = token.find_last_of('.');
+            if (dots != std::string::npos) token.erase(0, dots + 1);
+            // Castling may be written with zeros, "0-0", so only all-digit tokens are move numbers
+            bool moveNumber = std::all_of(token.begin(), token.end(),
+                                          [](char d) { return std::isdigit(static_cast<unsigned char>(d)); });
+            bool result = token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+            if (token.empty() || token[0] == '$' || moveNumber || result) continue;
+
+            Move move;
+            if (!ParseSAN(token, move)) return;
+
+            int moverResult = gamestate.whiteToMove ? whiteResult : 2 - whiteResult;
+            writer.Add(book.PolyglotKey(gamestate), OpeningBook::EncodeMove(move), moverResult);
+            gamestate.MakeMove(move);
+            ++ply;
+        }
+    }
+
+public:
+    long games = 0;
+
+    PGNReader(const Options& builderOptions, RunWriter& runWriter) : options(builderOptions), writer(runWriter) {}
+
+    void EndGame() {
+        // Games without a decisive or drawn result can't say anything about the moves
+        if (!movetext.empty() && whiteResult != -1) {
+            ReplayGame();
+            ++games;
+        }
+        fen.clear();
+        movetext.clear();
+        whiteResult = -1;
+        inComment = false;
+    }
+
+    void ReadLine(const std::string& line) {
+        if (line.empty() || line[0] == '%') return;
+
+        if (line[0] == '[' && !inComment) {
+            if (!movetext.empty()) EndGame();
+
+            size_t open = line.find('"'), close = line.rfind('"');
+            if (open == std::string::npos || close <= open) return;
+            std::string value = line.substr(open + 1, close - open - 1);
+
+            if (line.rfind("[Result ", 0) == 0) {
+                if (value == "1-0") whiteResult = Win;
+                else if (value == "0-1") whiteResult = Loss;
+                else if (value == "1/2-1/2") whiteResult = DrawResult;
+            } else if (line.rfind("[FEN ", 0) == 0) {
+                fen = value;
+            }
+            return;
+        }
+
+        // A ';' outside a {} comment comments out the rest of the line
+        size_t end = 0;
+        for (; end < line.size(); ++end) {
+            if (inComment) inComment = line[end] != '}';
+            else if (line[end] == '{') inComment = true;
+            else if (line[end] == ';') break;
+        }
+        movetext.append(line, 0, end);
+        movetext += ' ';
+    }
+};
+
+void MergeRuns(const std::vector<std::string>& runs, const Options& options) {
+    std::vector<std::ifstream> files;
+    for (const std::string& path : runs) files.emplace_back(path, std::ios::binary);
+
+    using Head = std::pair<Tally, size_t>;
+    auto later = [](const Head& a, const Head& b) { return b.first < a.first; };
+    std::priority_queue<Head, std::vector<Head>, decltype(later)> heads(later);
+
+    auto advance = [&](size_t run) {
+        Tally tally;
+        if (files[run].read(reinterpret_cast<char*>(&tally), sizeof(tally))) heads.emplace(tally, run);
+    };
+    for (size_t run = 0; run < files.size(); ++run) advance(run);
+
+    std::ofstream book(options.output, std::ios::binary);
+    auto writeBigEndian = [&book](U64 value, int bytes) {
+        for (int shift = 8 * (bytes - 1); shift >= 0; shift -= 8) book.put(static_cast<char>(value >> shift & 0xff));
+    };
+
+    long entries = 0;
+    while (!heads.empty()) {
+        Tally total = heads.top().first;
+        total.wins = total.draws = total.losses = 0;
+
+        while (!heads.empty() && heads.top().first.key == total.key && heads.top().first.move == total.move) {
+            auto [tally, run] = heads.top();
+            heads.pop();
+            total.wins += tally.wins;
+            total.draws += tally.draws;
+            total.losses += tally.losses;
+            advance(run);
+        }
+
+        if (static_cast<int>(total.wins + total.draws + total.losses) < options.minGames) continue;
+
+        // Polyglot's usual weighting, a draw is worth half a win
+        U64 weight = std::min<U64>(2ULL * total.wins + total.draws, 0xffff);
+        if (weight == 0) continue;
+
+        writeBigEndian(total.key, 8);
+        writeBigEndian(total.move, 2);
+        writeBigEndian(weight, 2);
+        writeBigEndian(0, 4);
+        ++entries;
+    }
+    std::cout << "wrote " << entries << " entries to " << options.output << std::endl;
+}
+
+bool ParseArguments(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (argument == "-o" && hasValue) options.output = argv[++i];
+        else if (argument == "-ply" && hasValue) options.maxPly = std::stoi(argv[++i]);
+        else if (argument == "-min" && hasValue) options.minGames = std::stoi(argv[++i]);
+        else if (argument == "-mem" && hasValue) options.memory = std::stoul(argv[++i]);
+        else if (argument == "-threads" && hasValue) options.threads = std::max(1, std::stoi(argv[++i]));
+        else if (argument[0] == '-') return false;
+        else options.inputs.push_back(argument);
+    }
+    return !options.inputs.empty();
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseArguments(argc, argv, options)) {
+        std::cerr << "usage: BookBuilder [-o book.bin] [-ply 24] [-min 3] [-mem 512] [-threads N] "
+                     "games.pgn..." << std::endl;
+        return 1;
+    }
+
+    MovementTables::LoadTables();
+
+    std::vector<std::string> runs;
+    std::mutex runsMutex;
+    std::atomic<size_t> nextShard = 0;
+    std::atomic<long> totalGames = 0;
+
+    int threadCount = std::min<int>(options.threads, static_cast<int>(options.inputs.size()));
+    size_t bytesPerThread = options.memory * 1024 * 1024 / threadCount;
+
+    std::vector<std::thread> workers;
+    for (int thread = 0; thread < threadCount; ++thread) {
+        workers.emplace_back([&, thread] {
+            RunWriter writer(options.output + ".run" + std::to_string(thread) + "-", bytesPerThread, runs, runsMutex);
+
+            for (size_t shard = nextShard++; shard < options.inputs.size(); shard = nextShard++) {
+                std::ifstream file(options.inputs[shard]);
+                if (!file) {
+                    std::cerr << "can't read " << options.inputs[shard] << std::endl;
+                    continue;
+                }
+
+                PGNReader reader(options, writer);
+                std::string line;
+                while (std::getline(file, line)) {
+                    if (!line.empty() && line.back() == '\r') line.pop_back();
+                    reader.ReadLine(line);
+                }
+                reader.EndGame();
+
+                totalGames += reader.games;
+                std::cout << options.inputs[shard] << ": " << reader.games << " games" << std::endl;
+            }
+            writer.Flush();
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+
+    std::cout << totalGames << " games in " << runs.size() << " runs" << std::endl;
+    MergeRuns(runs, options);
+
+    for (const std::string& path : runs) std::remove(path.c_str());
+    return 0;
+}
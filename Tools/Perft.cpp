@@ -0,0 +1,217 @@
+// Counts the leaf nodes of a position's move tree, or checks the move generator against a suite:
+//
+//   Perft [-depth N] [-threads N] [-hash MB] [-compare] [fen]
+//   Perft -suite quick|standard|full [-threads N] [-hash MB] [-o results.jsonl]
+//         [-baseline results.jsonl] [-tolerance percent]
+//
+// With -hash the counts of subtrees already walked are kept in a table of that size, so a
+// subtree reached again by transposition is looked up instead of walked. The hit rate is printed.
+// With -compare the position is also counted without the table, the two counts are checked against
+// each other and the speedup is printed. As the table trusts Zobrist keys alone, a count that
+// differs points at a key collision or a key that MakeMove doesn't keep up to date.
+//
+// A suite counts the positions of Test.h one after another and writes one JSON object per position
+// with its nodes, time and speed, followed by the totals. Given the output of an earlier run as a
+// baseline, each count must also match the baseline's and the total speed must not have fallen by
+// more than the tolerance, 10% unless set. Exits with 2 if any count is wrong, 3 if only the speed
+// regressed and 0 otherwise.
+
+#include "gamestate.h"
+#include "movegen.h"
+#include "PerftTable.h"
+#include "Test.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+
+
+struct Options {
+    int depth = 5;
+    int threads = 0; // one per core
+    int hash = 0;    // MB, 0 to count without a table
+    bool compare = false;
+    std::string fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+    std::optional<MoveGenTest::Level> suite;
+    std::string output;
+    std::string baseline;
+    double tolerance = 10; // percent
+};
+
+enum ExitCode {
+    Passed = 0,
+    UsageError = 1,
+    CountMismatch = 2,
+    SpeedRegression = 3,
+};
+
+// What a run wrote for each position and depth, and its total speed
+struct Baseline {
+    std::map<std::pair<int, int>, U64> nodes;
+    double nps = 0;
+};
+
+bool ParseArguments(int argc, char** argv, Options& options) {
+    bool fenGiven = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (argument == "-depth" && hasValue) options.depth = std::max(1, std::stoi(argv[++i]));
+        else if (argument == "-threads" && hasValue) options.threads = std::max(1, std::stoi(argv[++i]));
+        else if (argument == "-hash" && hasValue) options.hash = std::max(0, std::stoi(argv[++i]));
+        else if (argument == "-compare") options.compare = true;
+        else if (argument == "-o" && hasValue) options.output = argv[++i];
+        else if (argument == "-baseline" && hasValue) options.baseline = argv[++i];
+        else if (argument == "-tolerance" && hasValue) options.tolerance = std::stod(argv[++i]);
+        else if (argument == "-suite" && hasValue) {
+            std::string level = argv[++i];
+            if (level == "quick") options.suite = MoveGenTest::QuickTest;
+            else if (level == "standard") options.suite = MoveGenTest::StandardTest;
+            else if (level == "full") options.suite = MoveGenTest::FullTest;
+            else return false;
+        }
+        else if (argument[0] == '-' || fenGiven) return false;
+        else {
+            options.fen = argument;
+            fenGiven = true;
+        }
+    }
+    return true;
+}
+
+// Nodes and seconds taken
+U64 Count(const std::string& fen, int depth, const Options& options, bool hashed, double& seconds) {
+    Gamestate::Get().Seed(fen);
+    if (hashed) PerftTable::Get().Clear();
+
+    auto start = std::chrono::steady_clock::now();
+    U64 nodes = MoveGenerator::Get().ParallelPerft(depth, options.threads, hashed);
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return nodes;
+}
+
+void Print(const char* label, U64 nodes, double seconds) {
+    std::cout << std::left << std::setw(8) << label << std::right << std::setw(14) << nodes << " nodes"
+              << std::fixed << std::setprecision(3) << std::setw(10) << seconds << " s" << std::setprecision(0)
+              << std::setw(14) << nodes / std::max(seconds, 1e-9) << " nps" << std::endl;
+}
+
+// The number after "name": on a line written by RunSuite
+bool ReadField(const std::string& line, const std::string& name, double& value) {
+    size_t at = line.find("\"" + name + "\":");
+    if (at == std::string::npos) return false;
+    value = std::stod(line.substr(at + name.size() + 3));
+    return true;
+}
+
+bool ReadBaseline(const std::string& path, Baseline& baseline) {
+    std::ifstream file(path);
+    if (!file) return false;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        double position, depth, nodes, nps;
+        if (ReadField(line, "position", position) && ReadField(line, "depth", depth) && ReadField(line, "nodes", nodes)) {
+            baseline.nodes[{static_cast<int>(position), static_cast<int>(depth)}] = static_cast<U64>(nodes);
+        } else if (line.find("\"total\"") != std::string::npos && ReadField(line, "nps", nps)) {
+            baseline.nps = nps;
+        }
+    }
+    return true;
+}
+
+int RunSuite(const Options& options) {
+    Baseline baseline;
+    if (!options.baseline.empty() && !ReadBaseline(options.baseline, baseline)) {
+        std::cerr << "can't read " << options.baseline << std::endl;
+        return UsageError;
+    }
+
+    std::ofstream outputFile;
+    if (!options.output.empty()) outputFile.open(options.output);
+    std::ostream& output = options.output.empty() ? std::cout : outputFile;
+
+    U64 totalNodes = 0;
+    double totalSeconds = 0;
+    int failures = 0;
+    for (const MoveGenTest::PerftCase& test : MoveGenTest::PerftSuite(*options.suite)) {
+        double seconds;
+        U64 nodes = Count(MoveGenTest::positions[test.position], test.depth, options, options.hash > 0, seconds);
+        totalNodes += nodes;
+        totalSeconds += seconds;
+
+        auto recorded = baseline.nodes.find({test.position + 1, test.depth});
+        bool passed = nodes == test.expected && (recorded == baseline.nodes.end() || recorded->second == nodes);
+        if (!passed) {
+            ++failures;
+            std::cerr << "position " << test.position + 1 << " depth " << test.depth << ": " << nodes
+                      << " nodes, expected " << test.expected;
+            if (recorded != baseline.nodes.end()) std::cerr << ", baseline " << recorded->second;
+            std::cerr << std::endl;
+        }
+
+        output << std::fixed << std::setprecision(6) << "{\"position\":" << test.position + 1 << ",\"depth\":"
+               << test.depth << ",\"nodes\":" << nodes << ",\"expected\":" << test.expected << ",\"time\":"
+               << seconds << ",\"nps\":" << std::setprecision(0) << nodes / std::max(seconds, 1e-9)
+               << ",\"passed\":" << (passed ? "true" : "false") << "}" << std::endl;
+    }
+
+    double nps = totalNodes / std::max(totalSeconds, 1e-9);
+    output << std::fixed << std::setprecision(6) << "{\"total\":true,\"nodes\":" << totalNodes << ",\"time\":"
+           << totalSeconds << ",\"nps\":" << std::setprecision(0) << nps << ",\"failures\":" << failures << "}"
+           << std::endl;
+
+    std::cerr << failures << " counts wrong, " << std::fixed << std::setprecision(0) << nps << " nps";
+    bool regressed = false;
+    if (baseline.nps > 0) {
+        double change = 100 * (nps / baseline.nps - 1);
+        regressed = change < -options.tolerance;
+        std::cerr << ", " << std::showpos << std::setprecision(1) << change << std::noshowpos << "% against the baseline";
+    }
+    std::cerr << std::endl;
+
+    if (failures) return CountMismatch;
+    return regressed ? SpeedRegression : Passed;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseArguments(argc, argv, options) || (options.compare && !options.hash)) {
+        std::cerr << "usage: Perft [-depth N] [-threads N] [-hash MB] [-compare] [fen]\n"
+                     "       Perft -suite quick|standard|full [-threads N] [-hash MB] [-o results.jsonl] "
+                     "[-baseline results.jsonl] [-tolerance percent]\n"
+                     "-compare needs -hash" << std::endl;
+        return UsageError;
+    }
+
+    MovementTables::LoadTables();
+    if (options.hash) PerftTable::Get().Resize(options.hash);
+    if (options.suite) return RunSuite(options);
+
+    double seconds;
+    U64 nodes = Count(options.fen, options.depth, options, options.hash > 0, seconds);
+    Print(options.hash ? "hashed" : "plain", nodes, seconds);
+    if (options.hash) {
+        std::cout << "hash hit rate " << std::setprecision(1) << 100 * PerftTable::Get().HitRate() << "% of "
+                  << PerftTable::Get().probes << " probes" << std::endl;
+    }
+    if (!options.compare) return Passed;
+
+    double plainSeconds;
+    U64 plainNodes = Count(options.fen, options.depth, options, false, plainSeconds);
+    Print("plain", plainNodes, plainSeconds);
+    std::cout << "speedup " << std::setprecision(2) << plainSeconds / std::max(seconds, 1e-9) << "x" << std::endl;
+
+    if (plainNodes != nodes) {
+        std::cout << "counts differ by " << static_cast<long long>(nodes - plainNodes) << std::endl;
+        return CountMismatch;
+    }
+    return Passed;
+}
@@ -0,0 +1,197 @@
+// Tunes registered parameters by simultaneous perturbation stochastic approximation:
+//
+//   SPSA [-iterations N] [-pairs N] [-concurrency N] [-tc base+inc | -movetime ms | -nodes N | -depth N]
+//        [-hash MB] [-tune name,...] [-start "name=value,..."] [-rate R] [-o best.txt] [openings.epd]
+//
+// Every iteration nudges all the tuned values at once, each up or down at random by a step that
+// shrinks over time, and plays the set pushed one way against the set pushed the other in game
+// pairs run in parallel. The values then move towards whichever side scored better. The current
+// values are printed after each iteration in the form -a, -b, -params and -start take.
+
+#include "gamestate.h"
+#include "Search.h"
+#include "NNUE.h"
+#include "Bitbase.h"
+#include "Tablebase.h"
+#include "Parameters.h"
+#include "SelfPlay.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+struct Options {
+    SearchLimits limits;
+    int iterations = 1000;
+    int pairs = 8; // game pairs per iteration
+    int concurrency = std::max(1u, std::thread::hardware_concurrency());
+    int hash = 64; // MB
+    double rate = 0.005;
+    std::string tune;
+    Parameters start;
+    std::string openings;
+    std::string output;
+};
+
+struct Tuned {
+    const Parameters::Info* info;
+    double value;
+    double step; // the perturbation at the first iteration
+};
+
+bool ParseArguments(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (argument == "-iterations" && hasValue) options.iterations = std::max(1, std::stoi(argv[++i]));
+        else if (argument == "-pairs" && hasValue) options.pairs = std::max(1, std::stoi(argv[++i]));
+        else if (argument == "-concurrency" && hasValue) options.concurrency = std::max(1, std::stoi(argv[++i]));
+        else if (argument == "-hash" && hasValue) options.hash = std::max(1, std::stoi(argv[++i]));
+        else if (argument == "-rate" && hasValue) options.rate = std::stod(argv[++i]);
+        else if (argument == "-tune" && hasValue) options.tune = argv[++i];
+        else if (argument == "-o" && hasValue) options.output = argv[++i];
+        else if (argument == "-start" && hasValue) {
+            if (!options.start.Apply(argv[++i])) return false;
+        }
+        else if (hasValue && SelfPlay::ParseLimit(argument, argv[i + 1], options.limits)) ++i;
+        else if (argument[0] == '-' || !options.openings.empty()) return false;
+        else options.openings = argument;
+    }
+
+    SelfPlay::DefaultLimit(options.limits);
+    return true;
+}
+
+// Every registered parameter unless a list is given
+bool SelectParameters(const Options& options, std::vector<Tuned>& tuned) {
+    std::vector<std::string> names;
+    std::istringstream stream(options.tune);
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+        if (!name.empty()) names.push_back(name);
+    }
+
+    for (const Parameters::Info& info : Parameters::All()) {
+        if (!names.empty() && std::find(names.begin(), names.end(), info.name) == names.end()) continue;
+        tuned.push_back({&info, static_cast<double>(options.start.*info.value), std::max(1.0, (info.max - info.min) / 20.0)});
+    }
+
+    for (const std::string& wanted : names) {
+        if (std::none_of(tuned.begin(), tuned.end(), [&](const Tuned& t) { return wanted == t.info->name; })) {
+            std::cerr << "unknown parameter " << wanted << std::endl;
+            return false;
+        }
+    }
+    return !tuned.empty();
+}
+
+std::string Describe(const std::vector<Tuned>& tuned) {
+    std::string text;
+    for (const Tuned& parameter : tuned) {
+        if (!text.empty()) text += ',';
+        text += std::string(parameter.info->name) + "=" + std::to_string(std::lround(parameter.value));
+    }
+    return text;
+}
+
+// Wins minus losses of plus against minus
+int PlayPairs(const Parameters& plus, const Parameters& minus, const std::vector<std::string>& openings,
+              size_t& nextOpening, const Options& options) {
+    std::atomic<int> nextGame = 0, balance = 0;
+    size_t firstOpening = nextOpening;
+    nextOpening += options.pairs;
+
+    std::vector<std::thread> workers;
+    for (int thread = 0; thread < std::min(options.concurrency, 2 * options.pairs); ++thread) {
+        workers.emplace_back([&] {
+            while (true) {
+                int game = nextGame++;
+                if (game >= 2 * options.pairs) return;
+
+                const std::string& opening = openings[(firstOpening + game / 2) % openings.size()];
+                bool plusIsWhite = game % 2 == 0;
+                SelfPlay::Outcome outcome = plusIsWhite ? SelfPlay::PlayGame(opening, plus, minus, options.limits)
+                                                        : SelfPlay::PlayGame(opening, minus, plus, options.limits);
+
+                if (outcome == SelfPlay::Outcome::Drawn) continue;
+                balance += (outcome == SelfPlay::Outcome::WhiteWins) == plusIsWhite ? 1 : -1;
+            }
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+    return balance;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    std::vector<Tuned> tuned;
+    if (!ParseArguments(argc, argv, options) || !SelectParameters(options, tuned)) {
+        std::cerr << "usage: SPSA [-iterations N] [-pairs N] [-concurrency N] [-tc base+inc | -movetime ms | -nodes N | "
+                     "-depth N] [-hash MB] [-tune name,...] [-start params] [-rate R] [-o best.txt] [openings.epd]\n"
+                     "parameters: " << Parameters().ToString() << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> openings;
+    if (!options.openings.empty()) openings = SelfPlay::ReadOpenings(options.openings);
+    if (openings.empty()) {
+        std::cerr << "no openings, every pair starts from the initial position" << std::endl;
+        openings.push_back(SelfPlay::startingFen);
+    }
+
+    std::mt19937 random(std::random_device{}());
+    std::shuffle(openings.begin(), openings.end(), random);
+
+    MovementTables::LoadTables();
+    NNUENetwork::Get().Load("nnue.bin");
+    Bitbases::Get().Init("bitbases.bin");
+    Tablebases::Get().Init("tablebases");
+    TranspositionTable::Get().Resize(options.hash);
+
+    // The usual gains: steps shrink as k^-0.101 and the learning rate as (A + k)^-0.602
+    const double stability = options.iterations / 10.0;
+    size_t nextOpening = 0;
+
+    for (int iteration = 1; iteration <= options.iterations; ++iteration) {
+        double stepScale = std::pow(iteration, -0.101);
+        double rate = options.rate * std::pow((stability + 1) / (stability + iteration), 0.602);
+
+        Parameters plus = options.start, minus = options.start;
+        std::vector<int> directions;
+        for (const Tuned& parameter : tuned) {
+            int direction = random() % 2 ? 1 : -1;
+            directions.push_back(direction);
+
+            double step = parameter.step * stepScale * direction;
+            auto clamped = [&](double value) {
+                return std::clamp(static_cast<int>(std::lround(value)), parameter.info->min, parameter.info->max);
+            };
+            plus.Set(parameter.info->name, clamped(parameter.value + step));
+            minus.Set(parameter.info->name, clamped(parameter.value - step));
+        }
+
+        int balance = PlayPairs(plus, minus, openings, nextOpening, options);
+
+        for (size_t i = 0; i < tuned.size(); ++i) {
+            Tuned& parameter = tuned[i];
+            parameter.value += rate * parameter.step * stepScale * balance * directions[i];
+            parameter.value = std::clamp(parameter.value, static_cast<double>(parameter.info->min),
+                                         static_cast<double>(parameter.info->max));
+            options.start.Set(parameter.info->name, static_cast<int>(std::lround(parameter.value)));
+        }
+
+        std::string values = Describe(tuned);
+        std::cout << "iteration " << iteration << "  plus " << (balance >= 0 ? "+" : "") << balance << "  " << values
+                  << std::endl;
+        if (!options.output.empty()) std::ofstream(options.output) << values << '\n';
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "SelfPlay.h"
+#include "movegen.h"
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+
+bool SelfPlay::InsufficientMaterial(const Gamestate& gamestate) {
+    U64 heavy = gamestate.w_pawn | gamestate.b_pawn | gamestate.w_rook | gamestate.b_rook |
+                gamestate.w_queen | gamestate.b_queen;
+    return !heavy && bit_cnt(gamestate.all_pieces) <= 3;
+}
+
+SelfPlay::Outcome SelfPlay::PlayGame(const std::string& fen, const Parameters& white, const Parameters& black,
+                                     const SearchLimits& limits, int maxPlies) {
+    Gamestate& gamestate = Gamestate::Get();
+    gamestate.Seed(fen);
+
+    int clocks[2] = {limits.timeLeft, limits.timeLeft};
+    for (int ply = 0; ply < maxPlies; ++ply) {
+        int side = gamestate.whiteToMove ? 0 : 1;
+
+        MoveGenerator& moveGenerator = MoveGenerator::Get();
+        if (moveGenerator.GenerateLegalMoves().empty()) {
+            if (!moveGenerator.king_is_in_check) return Outcome::Drawn;
+            return side == 0 ? Outcome::BlackWins : Outcome::WhiteWins;
+        }
+        if (gamestate.result == Draw || InsufficientMaterial(gamestate)) return Outcome::Drawn;
+
+        Parameters::Get() = side == 0 ? white : black;
+
+        SearchLimits moveLimits = limits;
+        moveLimits.timeLeft = clocks[side];
+        auto start = std::chrono::steady_clock::now();
+        MovePicker::Get().InitSearch(moveLimits);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+        if (limits.timeLeft > 0) {
+            clocks[side] -= static_cast<int>(elapsed.count());
+            if (clocks[side] < 0) return side == 0 ? Outcome::BlackWins : Outcome::WhiteWins;
+            clocks[side] += limits.increment;
+        }
+
+        gamestate.MakeMove(MovePicker::Get().bestMove);
+    }
+    return Outcome::Drawn;
+}
+
+bool SelfPlay::ParseLimit(const std::string& option, const std::string& value, SearchLimits& limits) {
+    if (option == "-movetime") limits.moveTime = std::stoi(value);
+    else if (option == "-nodes") limits.nodes = std::stoll(value);
+    else if (option == "-depth") limits.depth = std::stoi(value);
+    else if (option == "-tc") {
+        size_t plus = value.find('+');
+        limits.timeLeft = static_cast<int>(std::stod(value.substr(0, plus)) * 1000);
+        if (plus != std::string::npos) limits.increment = static_cast<int>(std::stod(value.substr(plus + 1)) * 1000);
+    }
+    else return false;
+    return true;
+}
+
+void SelfPlay::DefaultLimit(SearchLimits& limits) {
+    if (!limits.timeLeft && !limits.moveTime && !limits.nodes && !limits.depth) limits.nodes = 20000;
+}
+
+std::vector<std::string> SelfPlay::ReadOpenings(const std::string& path) {
+    std::vector<std::string> openings;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream stream(line);
+        std::vector<std::string> fields(4);
+        bool complete = true;
+        for (std::string& field : fields) complete = complete && static_cast<bool>(stream >> field);
+        if (!complete || line[0] == '#') continue;
+
+        openings.push_back(fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3] + " 0 1");
+    }
+    return openings;
+}
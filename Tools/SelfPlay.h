@@ -0,0 +1,35 @@
+#ifndef CHESS_ENGINE_SELFPLAY_H
+#define CHESS_ENGINE_SELFPLAY_H
+
+#include "gamestate.h"
+#include "Search.h"
+#include "Parameters.h"
+#include <string>
+#include <vector>
+
+
+// Engine against engine games for the match and tuning tools, played on the calling thread
+namespace SelfPlay {
+    enum class Outcome {WhiteWins, Drawn, BlackWins};
+
+    const std::string startingFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+    bool InsufficientMaterial(const Gamestate& gamestate);
+
+    // Switches the thread's parameters to whichever side is to move. With a clock in the limits,
+    // each side's time is kept and a flag fall loses. Games still going after maxPlies are drawn.
+    Outcome PlayGame(const std::string& fen, const Parameters& white, const Parameters& black,
+                     const SearchLimits& limits, int maxPlies = 600);
+
+    // -tc base+inc in seconds, -movetime ms, -nodes N or -depth N. False for any other option.
+    bool ParseLimit(const std::string& option, const std::string& value, SearchLimits& limits);
+
+    // Without any limit every move would take the engine's default second
+    void DefaultLimit(SearchLimits& limits);
+
+    // The first four fields of every EPD or FEN line
+    std::vector<std::string> ReadOpenings(const std::string& path);
+}
+
+
+#endif //CHESS_ENGINE_SELFPLAY_H
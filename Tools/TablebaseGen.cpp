@@ -0,0 +1,511 @@
+// Generates tablebase files by retrograde analysis:
+//
+//   TablebaseGen [-d tablebases] KQvK KRvK KRPvKR...
+//
+// Every position is first classified by its captures and promotions, which lead into other
+// tables (generated first when missing), and by mate and stalemate. Results then spread
+// backwards one ply at a time from the mates and winning conversions, so each win or loss is
+// found at its distance to the next capture, promotion or mate, which is what the files store.
+//
+// Only the stored half or eighth of the board is walked. A position is reached backwards from
+// every mirror image of a resolved one, so each of its moves is still counted exactly once.
+
+#include "Tablebase.h"
+#include "movegen.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+namespace {
+    const int maxPieces = 5;
+    const int maxDistance = 126; // entries are bytes, longer distances are clamped
+    const int promotions[4] = {5, 4, 3, 2};
+
+    enum State : uint8_t {Unresolved, Resolved, CanDraw};
+
+    // An en passant capture the opponent doesn't have, the tables never give one
+    const int noEnPassant = -2;
+
+    bool IsPawn(int piece) { return (piece & 0b0111) == 1; }
+
+    U64 PawnAttacks(int color, int square) {
+        U64 pawn = 1ULL << square;
+        if (color == 0) return (pawn & ~Board::Files::hFile) << 9 | (pawn & ~Board::Files::aFile) << 7;
+        return (pawn & ~Board::Files::aFile) >> 9 | (pawn & ~Board::Files::hFile) >> 7;
+    }
+
+    U64 Attacks(int piece, int square, U64 occupancy) {
+        switch (piece & 0b0111) {
+            case 1:
+                return PawnAttacks(piece >> 3, square);
+            case 2:
+                return MovementTables::knightMoves[square];
+            case 3:
+                return BishopAttacks(square, occupancy);
+            case 4:
+                return RookAttacks(square, occupancy);
+            case 5:
+                return BishopAttacks(square, occupancy) | RookAttacks(square, occupancy);
+            default:
+                return MovementTables::kingMoves[square];
+        }
+    }
+
+    // The symmetries of a table: mirroring the files, then for pawnless ones the ranks and the diagonal
+    int Transform(int symmetry, int square) {
+        if (symmetry & 1) square ^= 7;
+        if (symmetry & 2) square ^= 56;
+        if (symmetry & 4) square = (square % 8) * 8 + square / 8;
+        return square;
+    }
+}
+
+class Generator {
+private:
+    const std::vector<int> pieces;
+    const int pieceCount;
+    const bool pawns;
+    const uint64_t positionCount;
+    int kingIndex[2] = {-1, -1};
+
+    std::vector<int8_t> entries;
+    std::vector<uint8_t> remaining; // moves not yet known to lose, for the side to move
+    std::vector<State> states;
+    std::vector<uint64_t> rounds[2]; // positions resolved at an even and an odd distance, not yet retracted
+    uint64_t pending[2] = {0, 0};
+
+    std::vector<int> decoded, canonical; // scratch space, so the inner loops don't allocate
+
+    U64 Occupancy(const std::vector<int>& squares, int color = -1) const {
+        U64 occupancy = 0;
+        for (int i = 0; i < pieceCount; ++i) {
+            if (color == -1 || pieces[i] >> 3 == color) occupancy |= 1ULL << squares[i];
+        }
+        return occupancy;
+    }
+
+    bool Attacked(int square, int byColor, const std::vector<int>& squares, U64 occupancy, int captured = -1) const {
+        for (int i = 0; i < pieceCount; ++i) {
+            if (i == captured || pieces[i] >> 3 != byColor) continue;
+            if (Attacks(pieces[i], squares[i], occupancy) & (1ULL << square)) return true;
+        }
+        return false;
+    }
+
+    // Both kings on the board, no piece sharing a square and the side that just moved not in check
+    bool Valid(const std::vector<int>& squares, int toMove) const {
+        U64 occupancy = Occupancy(squares);
+        if (bit_cnt(occupancy) != pieceCount) return false;
+        return !Attacked(squares[kingIndex[toMove ^ 1]], toMove, squares, occupancy);
+    }
+
+    bool Canonical(const std::vector<int>& squares) {
+        canonical = squares;
+        TablebaseFormat::Canonicalize(pieces, canonical);
+        return canonical == squares;
+    }
+
+    void Resolve(uint64_t index, int entry, int distance) {
+        entries[index] = static_cast<int8_t>(entry);
+        states[index] = Resolved;
+        rounds[distance & 1][index / 64] |= 1ULL << (index % 64);
+        ++pending[distance & 1];
+    }
+
+    // Looks up a position of another table, from the point of view of its side to move
+    bool ProbeConversion(const std::vector<int>& childPieces, const std::vector<int>& childSquares, int toMove, int& wdl) const {
+        int entry;
+        if (!Tablebases::Get().ProbeMaterial(childPieces, childSquares, toMove == 0, entry)) {
+            std::cerr << "missing table for " << TablebaseFormat::Signature(childPieces) << std::endl;
+            return false;
+        }
+        wdl = TablebaseFormat::WDL(entry);
+        return true;
+    }
+
+    // The best result the side to move gets by taking the pawn that just moved two squares en passant
+    bool EnPassantOutcome(const std::vector<int>& squares, int toMove, int pushed, int& outcome) const {
+        outcome = noEnPassant;
+        int target = squares[pushed] + (toMove == 0 ? 8 : -8);
+        U64 occupancy = Occupancy(squares);
+
+        for (int i = 0; i < pieceCount; ++i) {
+            if (!IsPawn(pieces[i]) || pieces[i] >> 3 != toMove || !(PawnAttacks(toMove, squares[i]) & (1ULL << target))) continue;
+
+            std::vector<int> after = squares;
+            after[i] = target;
+            U64 afterOccupancy = (occupancy & ~(1ULL << squares[i]) & ~(1ULL << squares[pushed])) | 1ULL << target;
+            if (Attacked(after[kingIndex[toMove]], toMove ^ 1, after, afterOccupancy, pushed)) continue;
+
+            std::vector<int> childPieces, childSquares;
+            for (int j = 0; j < pieceCount; ++j) {
+                if (j == pushed) continue;
+                childPieces.push_back(pieces[j]);
+                childSquares.push_back(after[j]);
+            }
+
+            int wdl;
+            if (!ProbeConversion(childPieces, childSquares, toMove ^ 1, wdl)) return false;
+            outcome = std::max(outcome, -wdl);
+        }
+        return true;
+    }
+
+    bool Classify(uint64_t index) {
+        std::vector<int>& squares = decoded;
+        TablebaseFormat::Decode(pieces, index, squares);
+
+        // Mirror images stored twice and impossible positions are never probed
+        int toMove = static_cast<int>(index & 1);
+        if (!Canonical(squares) || !Valid(squares, toMove)) {
+            states[index] = Resolved;
+            return true;
+        }
+
+        U64 own = Occupancy(squares, toMove);
+        U64 occupancy = Occupancy(squares);
+        bool anyLegal = false, winningConversion = false, canDraw = false;
+        int quietMoves = 0;
+
+        // A move into another table, with the piece that moved becoming promoted if it's a pawn's
+        auto convert = [&](int moved, int captured, int promoted) {
+            std::vector<int> childPieces, childSquares;
+            for (int j = 0; j < pieceCount; ++j) {
+                if (j == captured) continue;
+                childPieces.push_back(j == moved && promoted ? (pieces[j] & 0b1000) | promoted : pieces[j]);
+                childSquares.push_back(squares[j]);
+            }
+
+            int wdl;
+            if (!ProbeConversion(childPieces, childSquares, toMove ^ 1, wdl)) return false;
+            if (wdl < 0) winningConversion = true;
+            if (wdl == 0) canDraw = true;
+            return true;
+        };
+
+        for (int i = 0; i < pieceCount; ++i) {
+            if (pieces[i] >> 3 != toMove) continue;
+
+            int from = squares[i];
+            U64 targets = Attacks(pieces[i], from, occupancy) & ~own;
+            if (IsPawn(pieces[i])) {
+                int forward = toMove == 0 ? 8 : -8;
+                targets &= occupancy;
+                if (!(occupancy & (1ULL << (from + forward)))) {
+                    targets |= 1ULL << (from + forward);
+                    bool startRank = from / 8 == (toMove == 0 ? 1 : 6);
+                    if (startRank && !(occupancy & (1ULL << (from + 2 * forward)))) targets |= 1ULL << (from + 2 * forward);
+                }
+            }
+
+            while (targets) {
+                int to = popLSB(targets);
+                int captured = -1;
+                for (int j = 0; j < pieceCount; ++j) {
+                    if (j != i && squares[j] == to) captured = j;
+                }
+
+                squares[i] = to;
+                U64 after = (occupancy & ~(1ULL << from)) | 1ULL << to;
+                bool legal = !Attacked(squares[kingIndex[toMove]], toMove ^ 1, squares, after, captured);
+
+                if (legal) {
+                    anyLegal = true;
+                    bool promotion = IsPawn(pieces[i]) && (to / 8 == 0 || to / 8 == 7);
+                    if (promotion) {
+                        for (int promoted : promotions) {
+                            if (!convert(i, captured, promoted)) return false;
+                        }
+                    } else if (captured != -1) {
+                        if (!convert(i, captured, 0)) return false;
+                    } else if (IsPawn(pieces[i]) && std::abs(to - from) == 16) {
+                        // Should the opponent win by taking en passant, the push loses whatever follows
+                        int outcome;
+                        if (!EnPassantOutcome(squares, toMove ^ 1, i, outcome)) return false;
+                        if (outcome < 1) ++quietMoves;
+                    } else {
+                        ++quietMoves;
+                    }
+                }
+                squares[i] = from;
+            }
+        }
+
+        bool inCheck = Attacked(squares[kingIndex[toMove]], toMove ^ 1, squares, occupancy);
+        if (winningConversion) {
+            Resolve(index, TablebaseFormat::Win(1), 1);
+        } else if (!anyLegal) {
+            if (inCheck) Resolve(index, TablebaseFormat::Loss(0), 0);
+            else states[index] = Resolved;
+        } else if (quietMoves == 0) {
+            // Every move converts into a table without winning
+            if (canDraw) states[index] = Resolved;
+            else Resolve(index, TablebaseFormat::Loss(1), 1);
+        } else {
+            remaining[index] = static_cast<uint8_t>(quietMoves);
+            states[index] = canDraw ? CanDraw : Unresolved;
+        }
+        return true;
+    }
+
+    // The positions the side that didn't move in index could have played its last move from,
+    // reached from each of its mirror images so none of their moves is missed
+    bool Retract(uint64_t index, int distance) {
+        std::vector<int> resolved(pieceCount);
+        TablebaseFormat::Decode(pieces, index, resolved);
+
+        int toMove = static_cast<int>(index & 1);
+        int moved = toMove ^ 1;
+        bool lost = TablebaseFormat::WDL(entries[index]) < 0;
+        int clamped = std::min(distance + 1, maxDistance);
+
+        std::vector<std::vector<int>> images;
+        for (int symmetry = 0; symmetry < (pawns ? 2 : 8); ++symmetry) {
+            std::vector<int> image(pieceCount);
+            for (int i = 0; i < pieceCount; ++i) image[i] = Transform(symmetry, resolved[i]);
+            if (std::find(images.begin(), images.end(), image) == images.end()) images.push_back(image);
+        }
+
+        for (std::vector<int>& squares : images) {
+            U64 occupancy = Occupancy(squares);
+            for (int i = 0; i < pieceCount; ++i) {
+                if (pieces[i] >> 3 != moved) continue;
+
+                int to = squares[i];
+                U64 origins;
+                bool doublePush = false;
+                if (IsPawn(pieces[i])) {
+                    int forward = moved == 0 ? 8 : -8;
+                    int rank = (moved == 0 ? to : 63 - to) / 8;
+                    origins = rank >= 2 ? 1ULL << (to - forward) & ~occupancy : 0;
+                    if (rank == 3 && origins && !(occupancy & (1ULL << (to - 2 * forward)))) {
+                        origins |= 1ULL << (to - 2 * forward);
+                    }
+                    doublePush = rank == 3;
+                } else {
+                    origins = Attacks(pieces[i], to, occupancy) & ~occupancy;
+                }
+
+                while (origins) {
+                    int from = popLSB(origins);
+
+                    // A push the mover can't win by, or can't play at all, for the en passant capture it allows
+                    bool winnable = true, counted = true;
+                    if (doublePush && std::abs(to - from) == 16) {
+                        int outcome;
+                        if (!EnPassantOutcome(squares, toMove, i, outcome)) return false;
+                        winnable = outcome < 0;
+                        counted = outcome < 1;
+                    }
+
+                    squares[i] = from;
+                    if (counted && Canonical(squares) && Valid(squares, moved)) {
+                        uint64_t previous = TablebaseFormat::Index(pieces, squares, moved == 0);
+                        if (states[previous] != Resolved) {
+                            if (lost) {
+                                if (winnable) Resolve(previous, TablebaseFormat::Win(clamped), distance + 1);
+                            } else if (--remaining[previous] == 0) {
+                                if (states[previous] == CanDraw) states[previous] = Resolved;
+                                else Resolve(previous, TablebaseFormat::Loss(clamped), distance + 1);
+                            }
+                        }
+                    }
+                    squares[i] = to;
+                }
+            }
+        }
+        return true;
+    }
+
+public:
+    explicit Generator(std::vector<int> material)
+            : pieces(std::move(material)), pieceCount(static_cast<int>(pieces.size())),
+              pawns(TablebaseFormat::HasPawns(pieces)), positionCount(TablebaseFormat::EntryCount(pieces)) {
+        for (int i = 0; i < pieceCount; ++i) {
+            if ((pieces[i] & 0b0111) == 6) kingIndex[pieces[i] >> 3] = i;
+        }
+    }
+
+    bool Generate() {
+        entries.assign(positionCount, 0);
+        remaining.assign(positionCount, 0);
+        states.assign(positionCount, Unresolved);
+        decoded.resize(pieceCount);
+        for (std::vector<uint64_t>& round : rounds) round.assign((positionCount + 63) / 64, 0);
+
+        for (uint64_t index = 0; index < positionCount; ++index) {
+            if (!Classify(index)) return false;
+        }
+
+        // Retracting the positions resolved at one distance resolves those at the next
+        for (int distance = 0; pending[0] || pending[1]; ++distance) {
+            std::vector<uint64_t>& round = rounds[distance & 1];
+            pending[distance & 1] = 0;
+            for (uint64_t word = 0; word < round.size(); ++word) {
+                uint64_t bits = round[word];
+                round[word] = 0;
+                while (bits) {
+                    uint64_t index = word * 64 + popLSB(bits);
+                    if (!Retract(index, distance)) return false;
+                }
+            }
+        }
+
+        // Anything never resolved can be held forever, so it's a draw and its entry stays 0
+        return true;
+    }
+
+    bool Write(const std::string& path) const {
+        std::string temporary = path + ".tmp";
+        std::ofstream file(temporary, std::ios::binary);
+        if (!file) return false;
+
+        auto write = [&file](const auto& value) { file.write(reinterpret_cast<const char*>(&value), sizeof(value)); };
+
+        std::vector<uint64_t> offsets{0};
+        std::vector<uint8_t> blocks;
+        for (uint64_t start = 0; start < positionCount; start += TablebaseFormat::blockSize) {
+            uint64_t end = std::min<uint64_t>(start + TablebaseFormat::blockSize, positionCount);
+            auto runLength = [&](uint64_t index) {
+                uint64_t run = index;
+                while (run < end && run - index < 128 && entries[run] == entries[index]) ++run;
+                return run - index;
+            };
+
+            // PackBits, repeats of three or more become runs and everything else is copied as is
+            for (uint64_t index = start; index < end;) {
+                uint64_t run = runLength(index);
+                if (run >= 3) {
+                    blocks.push_back(static_cast<uint8_t>(1 - static_cast<int>(run)));
+                    blocks.push_back(static_cast<uint8_t>(entries[index]));
+                    index += run;
+                    continue;
+                }
+
+                uint64_t literal = index;
+                while (literal < end && literal - index < 128 && runLength(literal) < 3) ++literal;
+                blocks.push_back(static_cast<uint8_t>(literal - index - 1));
+                for (; index < literal; ++index) blocks.push_back(static_cast<uint8_t>(entries[index]));
+            }
+            offsets.push_back(blocks.size());
+        }
+
+        file.write(TablebaseFormat::magic, 4);
+        write(TablebaseFormat::version);
+        write(static_cast<uint32_t>(pieceCount));
+        for (int piece : pieces) write(static_cast<uint8_t>(piece));
+        write(TablebaseFormat::blockSize);
+        write(positionCount);
+        write(static_cast<uint32_t>(offsets.size() - 1));
+        for (uint64_t offset : offsets) write(offset);
+        file.write(reinterpret_cast<const char*>(blocks.data()), static_cast<std::streamsize>(blocks.size()));
+
+        file.close();
+        if (!file) return false;
+        return std::rename(temporary.c_str(), path.c_str()) == 0;
+    }
+
+    void PrintSummary() const {
+        uint64_t wins = 0, draws = 0, losses = 0;
+        int longest = 0;
+        for (uint64_t index = 0; index < positionCount; ++index) {
+            int wdl = TablebaseFormat::WDL(entries[index]);
+            if (wdl > 0) ++wins;
+            else if (wdl < 0) ++losses;
+            else ++draws;
+            longest = std::max(longest, TablebaseFormat::DTZ(entries[index]));
+        }
+        std::cout << "  " << wins << " wins, " << draws << " draws or invalid, " << losses
+                  << " losses, longest " << longest << " plies" << std::endl;
+    }
+};
+
+bool Covered(std::vector<int> pieces) {
+    if (pieces.size() <= 2) return true;
+
+    // Any squares do for finding the table, these are ones a pawn can stand on
+    std::vector<int> squares;
+    for (size_t i = 0; i < pieces.size(); ++i) squares.push_back(8 + static_cast<int>(i));
+    int entry;
+    return Tablebases::Get().ProbeMaterial(pieces, squares, true, entry);
+}
+
+bool Build(const std::vector<int>& pieces, const std::string& directory) {
+    if (Covered(pieces)) return true;
+
+    // Captures and promotions lead into other tables, so those come first
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        if ((pieces[i] & 0b0111) == 6) continue;
+
+        std::vector<int> smaller = pieces, noSquares;
+        smaller.erase(smaller.begin() + static_cast<long>(i));
+        if (!Build(smaller, directory)) return false;
+
+        if (!IsPawn(pieces[i])) continue;
+        for (int promoted : promotions) {
+            std::vector<int> changed = pieces;
+            changed[i] = (pieces[i] & 0b1000) | promoted;
+            TablebaseFormat::Sort(changed, noSquares);
+            if (!Build(changed, directory)) return false;
+        }
+    }
+
+    std::string signature = TablebaseFormat::Signature(pieces);
+    std::cout << "generating " << signature << std::endl;
+    auto start = std::chrono::steady_clock::now();
+
+    Generator generator(pieces);
+    if (!generator.Generate()) return false;
+    generator.PrintSummary();
+
+    std::string path = directory + "/" + signature + TablebaseFormat::extension;
+    if (!generator.Write(path)) {
+        std::cerr << "can't write " << path << std::endl;
+        return false;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "  wrote " << path << " in " << elapsed.count() << " ms" << std::endl;
+
+    Tablebases::Get().Init(directory);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::string directory = "tablebases";
+    std::vector<std::string> signatures;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "-d" && i + 1 < argc) directory = argv[++i];
+        else signatures.push_back(argument);
+    }
+
+    if (signatures.empty()) {
+        std::cerr << "usage: TablebaseGen [-d tablebases] KQvK KRPvKR..." << std::endl;
+        return 1;
+    }
+
+    MovementTables::LoadTables();
+    std::filesystem::create_directories(directory);
+    Tablebases::Get().Init(directory);
+
+    for (const std::string& signature : signatures) {
+        std::vector<int> pieces;
+        if (!TablebaseFormat::ParseSignature(signature, pieces)) {
+            std::cerr << "can't read material " << signature << std::endl;
+            return 1;
+        }
+        if (pieces.size() > maxPieces) {
+            std::cerr << signature << ": only endings of up to " << maxPieces << " pieces are supported" << std::endl;
+            return 1;
+        }
+        if (!Build(pieces, directory)) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,529 @@
+// Tunes the hand written evaluation against positions labelled with the game's result:
+//
+//   Tuner [-threads N] [-epochs N] [-rate R] [-k K] [-o TunedWeights.h] positions.epd
+//
+// Each line is a FEN or EPD position with its result somewhere after it, as "1-0", "0-1" or
+// "1/2-1/2", or as [1.0], [0.5] or [0.0]. Positions are resolved with a quiescence search, and
+// the quiet position it settles on is stored as the list of evaluation terms it contains, so
+// an evaluation is a short dot product with the weights. The weights then follow the gradient
+// of the mean squared difference between the result and the sigmoid of the evaluation.
+// The tuned constants are written out as a header in the layout of evaluation.h and PawnHash.h.
+
+#include "gamestate.h"
+#include "movegen.h"
+#include "evaluation.h"
+#include "PawnHash.h"
+#include "Bitbase.h"
+#include "Search.h"
+#include "bitUtils.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Every weight is a mid game and end game pair, numbered in this order
+namespace Weights {
+    const int pieceValues = 0;                          // pawn to queen
+    const int pcSqTables = pieceValues + 5;              // pawn to king, 64 squares each, as written in the source
+    const int mobility = pcSqTables + 6 * 64;
+    const int kingAttack = mobility + 1;
+    const int space = kingAttack + 1;
+    const int blockedCenterPawn = space + 1;
+    const int passedPawn = blockedCenterPawn + 1;        // by rank
+    const int doubledPawn = passedPawn + 8;
+    const int isolatedPawn = doubledPawn + 1;
+    const int rookHalfOpenFile = isolatedPawn + 1;
+    const int rookOpenFile = rookHalfOpenFile + 1;
+    const int count = rookOpenFile + 1;
+}
+
+struct Feature {
+    uint16_t weight;
+    int16_t coefficient; // white's count minus black's
+};
+
+// A resolved position, about a hundred bytes with its features
+struct Sample {
+    uint32_t firstFeature;
+    uint16_t featureCount;
+    uint16_t phase;
+    float result; // 1 when white won
+    float fixed;  // the evaluator's terms that aren't tuned, like mop up, from white's point of view
+};
+
+struct Dataset {
+    std::vector<Sample> samples;
+    std::vector<Feature> features;
+    double drift = 0, maxDrift = 0; // summed and largest gap between the model and the evaluator, in cp
+};
+
+const double driftLimit = 2; // cp, Taper truncates so up to 1 is expected and more means ExtractFeatures has fallen behind
+
+struct Options {
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    int epochs = 300;
+    double rate = 1.0;
+    double k = 0; // 0 to fit it
+    std::string input;
+    std::string output = "TunedWeights.h";
+};
+
+std::vector<double> CurrentWeights() {
+    std::vector<double> weights(2 * Weights::count);
+    auto set = [&](int weight, Score score) {
+        weights[2 * weight] = MidGameValue(score);
+        weights[2 * weight + 1] = EndGameValue(score);
+    };
+
+    for (int piece = 0; piece < 5; ++piece) set(Weights::pieceValues + piece, PieceValues::values[piece]);
+
+    const std::array<int, 64>* midGame[6] = {&PcSqTables::midGamePawn, &PcSqTables::midGameKnight,
+                                             &PcSqTables::midGameBishop, &PcSqTables::midGameRook,
+                                             &PcSqTables::midGameQueen, &PcSqTables::midGameKing};
+    const std::array<int, 64>* endGame[6] = {&PcSqTables::endGamePawn, &PcSqTables::endGameKnight,
+                                             &PcSqTables::endGameBishop, &PcSqTables::endGameRook,
+                                             &PcSqTables::endGameQueen, &PcSqTables::endGameKing};
+    for (int piece = 0; piece < 6; ++piece) {
+        for (int square = 0; square < 64; ++square) {
+            set(Weights::pcSqTables + piece * 64 + square, S((*midGame[piece])[square], (*endGame[piece])[square]));
+        }
+    }
+
+    set(Weights::mobility, ActivityWeights::mobility);
+    set(Weights::kingAttack, ActivityWeights::kingAttack);
+    set(Weights::space, ActivityWeights::space);
+    set(Weights::blockedCenterPawn, ActivityWeights::blockedCenterPawn);
+
+    for (int rank = 0; rank < 8; ++rank) set(Weights::passedPawn + rank, PawnWeights::passedPawn[rank]);
+    set(Weights::doubledPawn, PawnWeights::doubledPawn);
+    set(Weights::isolatedPawn, PawnWeights::isolatedPawn);
+    set(Weights::rookHalfOpenFile, PawnWeights::rookHalfOpenFile);
+    set(Weights::rookOpenFile, PawnWeights::rookOpenFile);
+    return weights;
+}
+
+// The terms of Evaluator::StaticEvaluation, counted instead of weighted. Keep the two in step,
+// the tuner reports how far the model strays from the evaluator when it loads and stops if
+// that's more than rounding.
+void ExtractFeatures(std::vector<Feature>& features) {
+    Gamestate& gamestate = Gamestate::Get();
+    MoveGenerator& moveGenerator = MoveGenerator::Get();
+    std::map<int, int> counts;
+
+    for (int piece = 0; piece < 5; ++piece) {
+        counts[Weights::pieceValues + piece] += bit_cnt(*gamestate.bitboards[piece]) - bit_cnt(*gamestate.bitboards[piece + 6]);
+    }
+
+    // The white tables are flipped from the way they're written and the black ones are negated
+    for (int piece = 0; piece < 12; ++piece) {
+        U64 bitboard = *gamestate.bitboards[piece];
+        while (bitboard) {
+            int square = popLSB(bitboard);
+            if (piece < 6) ++counts[Weights::pcSqTables + piece * 64 + (square ^ 56)];
+            else --counts[Weights::pcSqTables + (piece - 6) * 64 + square];
+        }
+    }
+
+    moveGenerator.CalculateAttackMaps();
+    counts[Weights::mobility] += moveGenerator.mobility[0] - moveGenerator.mobility[1];
+    counts[Weights::blockedCenterPawn] += bit_cnt(~gamestate.empty_sqs & (1ULL << Board::Squares::d6 | 1ULL << Board::Squares::e6) & gamestate.b_pawn >> 8);
+    counts[Weights::blockedCenterPawn] -= bit_cnt(gamestate.all_pieces & (1ULL << Board::Squares::d3 | 1ULL << Board::Squares::e3) & gamestate.w_pawn << 8);
+
+    U64 whiteKingZone = moveGenerator.attacksBy[5] | gamestate.w_king;
+    U64 blackKingZone = moveGenerator.attacksBy[11] | gamestate.b_king;
+    for (int piece = 1; piece <= 4; ++piece) {
+        counts[Weights::kingAttack] += bit_cnt(moveGenerator.attacksBy[piece] & blackKingZone);
+        counts[Weights::kingAttack] -= bit_cnt(moveGenerator.attacksBy[piece + 6] & whiteKingZone);
+    }
+
+    const U64 centerFiles = Board::Files::cFile | Board::Files::dFile | Board::Files::eFile | Board::Files::fFile;
+    const U64 whiteHalf = Board::Ranks::rank_2 | Board::Ranks::rank_3 | Board::Ranks::rank_4;
+    const U64 blackHalf = Board::Ranks::rank_5 | Board::Ranks::rank_6 | Board::Ranks::rank_7;
+    U64 whiteSpace = centerFiles & whiteHalf & ~gamestate.w_pawn & ~moveGenerator.attacksBy[6] & moveGenerator.attacks[0];
+    U64 blackSpace = centerFiles & blackHalf & ~gamestate.b_pawn & ~moveGenerator.attacksBy[0] & moveGenerator.attacks[1];
+    counts[Weights::space] += bit_cnt(whiteSpace) - bit_cnt(blackSpace);
+
+    const PawnEntry& pawns = PawnHashTable::Get().Probe();
+    U64 whitePawns = gamestate.w_pawn, blackPawns = gamestate.b_pawn;
+    U64 whiteFiles = BitMasks::fileFill(whitePawns), blackFiles = BitMasks::fileFill(blackPawns);
+    U64 whiteNeighbours = (whiteFiles & ~Board::Files::hFile) << 1 | (whiteFiles & ~Board::Files::aFile) >> 1;
+    U64 blackNeighbours = (blackFiles & ~Board::Files::hFile) << 1 | (blackFiles & ~Board::Files::aFile) >> 1;
+
+    counts[Weights::doubledPawn] -= bit_cnt(whitePawns & BitMasks::northFill(whitePawns) << 8);
+    counts[Weights::doubledPawn] += bit_cnt(blackPawns & BitMasks::southFill(blackPawns) >> 8);
+    counts[Weights::isolatedPawn] -= bit_cnt(whitePawns & ~whiteNeighbours);
+    counts[Weights::isolatedPawn] += bit_cnt(blackPawns & ~blackNeighbours);
+
+    U64 passed = pawns.passedPawns[0];
+    while (passed) ++counts[Weights::passedPawn + popLSB(passed) / 8];
+    passed = pawns.passedPawns[1];
+    while (passed) --counts[Weights::passedPawn + 7 - popLSB(passed) / 8];
+
+    counts[Weights::rookHalfOpenFile] += bit_cnt(gamestate.w_rook & pawns.halfOpenFiles[0]);
+    counts[Weights::rookHalfOpenFile] -= bit_cnt(gamestate.b_rook & pawns.halfOpenFiles[1]);
+    counts[Weights::rookOpenFile] += bit_cnt(gamestate.w_rook & pawns.openFiles);
+    counts[Weights::rookOpenFile] -= bit_cnt(gamestate.b_rook & pawns.openFiles);
+
+    for (auto [weight, count] : counts) {
+        if (count) features.push_back({static_cast<uint16_t>(weight), static_cast<int16_t>(count)});
+    }
+}
+
+// Searches captures like MovePicker::QuiessenceSearch and keeps the line it settles on
+int Resolve(int alpha, int beta, int ply, std::vector<Move>& line) {
+    line.clear();
+    int standPat = Evaluator::Get().StaticEvaluation();
+    if (standPat >= beta || ply >= 16) return standPat;
+    alpha = std::max(alpha, standPat);
+
+    Gamestate& gamestate = Gamestate::Get();
+    std::vector<Move> captures = MoveGenerator::Get().GenerateLegalMoves(true);
+    MoveOrderer::Get().OrderMoves(&captures);
+
+    std::vector<Move> childLine;
+    for (Move move : captures) {
+        gamestate.MakeMove(move);
+        int eval = -Resolve(-beta, -alpha, ply + 1, childLine);
+        gamestate.UndoMove();
+
+        if (eval > alpha) {
+            alpha = eval;
+            line = {move};
+            line.insert(line.end(), childLine.begin(), childLine.end());
+            if (alpha >= beta) break;
+        }
+    }
+    return alpha;
+}
+
+bool ParseResult(const std::string& line, float& result) {
+    const std::pair<const char*, float> labels[] = {{"1/2-1/2", 0.5f}, {"1-0", 1.0f}, {"0-1", 0.0f},
+                                                    {"[0.5]", 0.5f}, {"[1.0]", 1.0f}, {"[0.0]", 0.0f}};
+    for (auto [label, value] : labels) {
+        if (line.find(label) != std::string::npos) {
+            result = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+double Evaluate(const Dataset& dataset, const Sample& sample, const std::vector<double>& weights) {
+    double midGame = 0, endGame = 0;
+    for (uint32_t i = sample.firstFeature; i < sample.firstFeature + sample.featureCount; ++i) {
+        const Feature& feature = dataset.features[i];
+        midGame += feature.coefficient * weights[2 * feature.weight];
+        endGame += feature.coefficient * weights[2 * feature.weight + 1];
+    }
+    return (midGame * (GamePhase::endgame - sample.phase) + endGame * sample.phase) / GamePhase::endgame + sample.fixed;
+}
+
+bool LoadSample(const std::string& line, Dataset& dataset) {
+    std::istringstream stream(line);
+    std::vector<std::string> fields(4);
+    for (std::string& field : fields) {
+        if (!(stream >> field)) return false;
+    }
+
+    float result;
+    if (!ParseResult(line, result)) return false;
+
+    Gamestate& gamestate = Gamestate::Get();
+    gamestate.Seed(fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3] + " 0 1");
+    if (MoveGenerator::Get().GenerateLegalMoves().empty()) return false;
+
+    std::vector<Move> quietLine;
+    Resolve(-Infinity, Infinity, 0, quietLine);
+    for (Move move : quietLine) gamestate.MakeMove(move);
+
+    // Positions the evaluator already scores as won, or the bitbases as drawn, teach the weights nothing
+    int whiteEval = Evaluator::Get().StaticEvaluation() * (gamestate.whiteToMove ? 1 : -1);
+    int bitbaseResult;
+    if (std::abs(whiteEval) >= KnownWin || Bitbases::Get().Probe(gamestate, bitbaseResult)) return false;
+
+    Sample sample;
+    sample.firstFeature = static_cast<uint32_t>(dataset.features.size());
+    sample.phase = static_cast<uint16_t>(gamestate.gamePhase);
+    sample.result = result;
+    ExtractFeatures(dataset.features);
+    sample.featureCount = static_cast<uint16_t>(dataset.features.size() - sample.firstFeature);
+
+    // Whatever the model leaves out is kept as a constant, so the untuned model matches the evaluator.
+    // Past the untuned terms the gap should only be rounding, anything more is a term ExtractFeatures misses.
+    static const std::vector<double> initialWeights = CurrentWeights();
+    sample.fixed = 0;
+    sample.fixed = static_cast<float>(whiteEval - Evaluate(dataset, sample, initialWeights));
+
+    double drift = std::abs(sample.fixed - Evaluator::Get().UntunedTerms());
+    dataset.drift += drift;
+    dataset.maxDrift = std::max(dataset.maxDrift, drift);
+
+    dataset.samples.push_back(sample);
+    return true;
+}
+
+// Splits the samples between the threads, runs work(thread, first, last) on each and adds up what they return
+double ParallelSum(size_t size, int threads, const std::function<double(int, size_t, size_t)>& work) {
+    std::vector<double> sums(threads);
+    std::vector<std::thread> workers;
+    for (int thread = 0; thread < threads; ++thread) {
+        workers.emplace_back([&, thread] {
+            sums[thread] = work(thread, size * thread / threads, size * (thread + 1) / threads);
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+
+    double total = 0;
+    for (double sum : sums) total += sum;
+    return total;
+}
+
+double Sigmoid(double k, double eval) {
+    return 1 / (1 + std::pow(10.0, -k * eval / 400));
+}
+
+double MeanError(const Dataset& dataset, const std::vector<double>& weights, double k, int threads) {
+    double total = ParallelSum(dataset.samples.size(), threads, [&](int, size_t first, size_t last) {
+        double sum = 0;
+        for (size_t i = first; i < last; ++i) {
+            double difference = dataset.samples[i].result - Sigmoid(k, Evaluate(dataset, dataset.samples[i], weights));
+            sum += difference * difference;
+        }
+        return sum;
+    });
+    return total / dataset.samples.size();
+}
+
+// The scaling that best fits the untuned evaluation to the results, found by narrowing a grid
+double FitK(const Dataset& dataset, const std::vector<double>& weights, int threads) {
+    double best = 1, step = 0.5;
+    double bestError = MeanError(dataset, weights, best, threads);
+    for (int round = 0; round < 6; ++round, step /= 4) {
+        for (double k = std::max(0.05, best - 4 * step); k <= best + 4 * step; k += step) {
+            double error = MeanError(dataset, weights, k, threads);
+            if (error < bestError) {
+                bestError = error;
+                best = k;
+            }
+        }
+    }
+    return best;
+}
+
+std::vector<double> Gradient(const Dataset& dataset, const std::vector<double>& weights, double k, int threads) {
+    std::vector<std::vector<double>> partials(threads, std::vector<double>(weights.size()));
+    ParallelSum(dataset.samples.size(), threads, [&](int thread, size_t first, size_t last) {
+        std::vector<double>& partial = partials[thread];
+        for (size_t i = first; i < last; ++i) {
+            const Sample& sample = dataset.samples[i];
+            double sigmoid = Sigmoid(k, Evaluate(dataset, sample, weights));
+
+            // d(error)/d(eval) of (result - sigmoid)^2
+            double slope = -2 * (sample.result - sigmoid) * sigmoid * (1 - sigmoid) * std::log(10.0) * k / 400;
+            double midGameShare = slope * (GamePhase::endgame - sample.phase) / GamePhase::endgame;
+            double endGameShare = slope * sample.phase / GamePhase::endgame;
+
+            for (uint32_t j = sample.firstFeature; j < sample.firstFeature + sample.featureCount; ++j) {
+                const Feature& feature = dataset.features[j];
+                partial[2 * feature.weight] += feature.coefficient * midGameShare;
+                partial[2 * feature.weight + 1] += feature.coefficient * endGameShare;
+            }
+        }
+        return 0.0;
+    });
+
+    std::vector<double> gradient(weights.size());
+    for (const std::vector<double>& partial : partials) {
+        for (size_t i = 0; i < gradient.size(); ++i) gradient[i] += partial[i] / dataset.samples.size();
+    }
+    return gradient;
+}
+
+void WriteHeader(const std::string& path, const std::vector<double>& weights, size_t positions, double k, double error) {
+    std::ofstream file(path);
+    auto value = [&](int weight, int half) { return static_cast<int>(std::lround(weights[2 * weight + half])); };
+    auto score = [&](int weight) {
+        return "S(" + std::to_string(value(weight, 0)) + ", " + std::to_string(value(weight, 1)) + ")";
+    };
+
+    file << "//\n// Written by Tools/Tuner from " << positions << " positions, K = " << k << ", error = "
+         << std::setprecision(6) << error << ".\n// Copy the blocks over their counterparts in evaluation.h and PawnHash.h.\n//\n\n";
+    file << "#ifndef CHESS_ENGINE_TUNEDWEIGHTS_H\n#define CHESS_ENGINE_TUNEDWEIGHTS_H\n\n";
+
+    const char* pieces[6] = {"Pawn", "Knight", "Bishop", "Rook", "Queen", "King"};
+    file << "namespace PieceValues {\n";
+    for (int half = 0; half < 2; ++half) {
+        for (int piece = 0; piece < 5; ++piece) {
+            file << "    const int " << (half ? "endGame" : "midGame") << pieces[piece] << " = "
+                 << value(Weights::pieceValues + piece, half) << ";\n";
+        }
+        if (!half) file << "\n";
+    }
+    file << "}\n\n";
+
+    file << "namespace ActivityWeights {\n"
+         << "    const Score mobility = " << score(Weights::mobility) << ";\n"
+         << "    const Score kingAttack = " << score(Weights::kingAttack) << ";\n"
+         << "    const Score space = " << score(Weights::space) << ";\n"
+         << "    const Score blockedCenterPawn = " << score(Weights::blockedCenterPawn) << ";\n}\n\n";
+
+    file << "namespace PcSqTables {\n";
+    for (int piece = 0; piece < 6; ++piece) {
+        for (int half = 0; half < 2; ++half) {
+            file << "    inline const std::array<int, 64> " << (half ? "endGame" : "midGame") << pieces[piece] << " = {\n";
+            for (int rank = 0; rank < 8; ++rank) {
+                file << "           ";
+                for (int column = 0; column < 8; ++column) {
+                    file << std::setw(5) << value(Weights::pcSqTables + piece * 64 + rank * 8 + column, half) << ",";
+                }
+                file << "\n";
+            }
+            file << "    };\n\n";
+        }
+    }
+    file << "}\n\n";
+
+    file << "namespace PawnWeights {\n    const Score passedPawn[8] = {";
+    for (int rank = 0; rank < 8; ++rank) file << (rank ? ", " : "") << score(Weights::passedPawn + rank);
+    file << "};\n"
+         << "    const Score doubledPawn = " << score(Weights::doubledPawn) << ";\n"
+         << "    const Score isolatedPawn = " << score(Weights::isolatedPawn) << ";\n\n"
+         << "    const Score rookHalfOpenFile = " << score(Weights::rookHalfOpenFile) << ";\n"
+         << "    const Score rookOpenFile = " << score(Weights::rookOpenFile) << ";\n}\n\n";
+
+    file << "#endif //CHESS_ENGINE_TUNEDWEIGHTS_H\n";
+}
+
+bool ParseArguments(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (argument == "-threads" && hasValue) options.threads = std::max(1, std::stoi(argv[++i]));
+        else if (argument == "-epochs" && hasValue) options.epochs = std::max(0, std::stoi(argv[++i]));
+        else if (argument == "-rate" && hasValue) options.rate = std::stod(argv[++i]);
+        else if (argument == "-k" && hasValue) options.k = std::stod(argv[++i]);
+        else if (argument == "-o" && hasValue) options.output = argv[++i];
+        else if (argument[0] == '-' || !options.input.empty()) return false;
+        else options.input = argument;
+    }
+    return !options.input.empty();
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseArguments(argc, argv, options)) {
+        std::cerr << "usage: Tuner [-threads N] [-epochs N] [-rate R] [-k K] [-o TunedWeights.h] positions.epd" << std::endl;
+        return 1;
+    }
+
+    std::ifstream input(options.input);
+    if (!input) {
+        std::cerr << "can't read " << options.input << std::endl;
+        return 1;
+    }
+
+    MovementTables::LoadTables();
+    Bitbases::Get().Init("bitbases.bin");
+
+    // A won KPK position has to be skipped, or the samples aren't scored the way the engine plays
+    Dataset covered;
+    if (LoadSample("4k3/8/8/3P4/8/8/8/4K3 w - - [1.0]", covered)) {
+        std::cerr << "positions the bitbases cover aren't skipped" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Each thread resolves into its own dataset, joined afterwards
+    std::mutex inputMutex;
+    std::vector<Dataset> parts(options.threads);
+    std::atomic<long> skipped = 0;
+    std::vector<std::thread> workers;
+    for (int thread = 0; thread < options.threads; ++thread) {
+        workers.emplace_back([&, thread] {
+            std::string line;
+            while (true) {
+                {
+                    std::lock_guard<std::mutex> lock(inputMutex);
+                    if (!std::getline(input, line)) return;
+                }
+                if (line.empty() || line[0] == '#' || !LoadSample(line, parts[thread])) ++skipped;
+            }
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+
+    Dataset dataset;
+    for (Dataset& part : parts) {
+        uint32_t offset = static_cast<uint32_t>(dataset.features.size());
+        for (Sample& sample : part.samples) {
+            sample.firstFeature += offset;
+            dataset.samples.push_back(sample);
+        }
+        dataset.features.insert(dataset.features.end(), part.features.begin(), part.features.end());
+        dataset.drift += part.drift;
+        dataset.maxDrift = std::max(dataset.maxDrift, part.maxDrift);
+        part = Dataset();
+    }
+    if (dataset.samples.empty()) {
+        std::cerr << "no labelled positions in " << options.input << std::endl;
+        return 1;
+    }
+
+    double unexplained = 0;
+    for (const Sample& sample : dataset.samples) unexplained += std::abs(sample.fixed);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << dataset.samples.size() << " positions loaded, " << skipped << " lines skipped in " << elapsed.count()
+              << " ms, " << dataset.features.size() << " features, untuned terms average "
+              << std::setprecision(3) << unexplained / dataset.samples.size() << " cp" << std::endl;
+    std::cout << "model strays from the evaluator by " << dataset.drift / dataset.samples.size()
+              << " cp on average, " << dataset.maxDrift << " cp at most" << std::endl;
+
+    if (dataset.maxDrift > driftLimit) {
+        std::cerr << "ExtractFeatures no longer matches Evaluator::StaticEvaluation, tuning it would be meaningless"
+                  << std::endl;
+        return 1;
+    }
+
+    std::vector<double> weights = CurrentWeights();
+    double k = options.k > 0 ? options.k : FitK(dataset, weights, options.threads);
+    double error = MeanError(dataset, weights, k, options.threads);
+    std::cout << "K = " << k << ", error " << std::setprecision(6) << error << std::endl;
+
+    // Adam, the step size is in centipawns
+    const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+    std::vector<double> momentum(weights.size()), velocity(weights.size());
+    for (int epoch = 1; epoch <= options.epochs; ++epoch) {
+        std::vector<double> gradient = Gradient(dataset, weights, k, options.threads);
+        for (size_t i = 0; i < weights.size(); ++i) {
+            momentum[i] = beta1 * momentum[i] + (1 - beta1) * gradient[i];
+            velocity[i] = beta2 * velocity[i] + (1 - beta2) * gradient[i] * gradient[i];
+            double corrected = momentum[i] / (1 - std::pow(beta1, epoch));
+            double scale = std::sqrt(velocity[i] / (1 - std::pow(beta2, epoch))) + epsilon;
+            weights[i] -= options.rate * corrected / scale;
+        }
+
+        if (epoch % 10 == 0 || epoch == options.epochs) {
+            error = MeanError(dataset, weights, k, options.threads);
+            std::cout << "epoch " << epoch << ", error " << error << std::endl;
+            WriteHeader(options.output, weights, dataset.samples.size(), k, error);
+        }
+    }
+    if (options.epochs == 0) WriteHeader(options.output, weights, dataset.samples.size(), k, error);
+
+    std::cout << "weights written to " << options.output << std::endl;
+    return 0;
+}
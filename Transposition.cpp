@@ -4,19 +4,126 @@
 
 #include "Transposition.h"
 #include "Search.h"
+#include "Parameters.h"
+#include "SearchStats.h"
+#include "Profile.h"
+#include <algorithm>
 
 
 TranspositionTable::TranspositionTable() {
+    Resize(32);
+}
+
+void TranspositionTable::Resize(int megabytes) {
+    U64 bucketCount = 1;
+    while (2 * bucketCount * sizeof(Bucket) <= static_cast<U64>(megabytes) << 20) {
+        bucketCount *= 2;
+    }
+
+    buckets = std::make_unique<Bucket[]>(bucketCount);
+    bucketMask = bucketCount - 1;
+}
+
+void TranspositionTable::Clear() {
+    for (U64 bucket = 0; bucket <= bucketMask; ++bucket) {
+        for (Slot& slot : buckets[bucket].slots) {
+            slot.keyXorData.store(0, std::memory_order_relaxed);
+            slot.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    generation = 0;
+}
+
+void TranspositionTable::NewSearch() {
+    // Entries from older searches stay usable but become the first to be replaced
+    ++generation;
+}
+
+U64 TranspositionTable::Pack(const Entry& entry) {
+    // Depth is stored one higher, so an all zero slot is empty
+    return static_cast<uint32_t>(entry.evaluation) |
+           static_cast<U64>(entry.bestMove.startSquare & 63) << 32 |
+           static_cast<U64>(entry.bestMove.endSquare & 63) << 38 |
+           static_cast<U64>((entry.bestMove.flag + 1) & 31) << 44 |
+           static_cast<U64>(std::clamp(entry.depth + 1, 0, 255)) << 49 |
+           static_cast<U64>(entry.evalType & 3) << 57 |
+           static_cast<U64>(entry.generation & generationMask) << 59;
+}
+
+TranspositionTable::Entry TranspositionTable::Unpack(U64 data) {
+    Entry entry;
+    entry.evaluation = static_cast<int32_t>(data & 0xffffffff);
+    entry.bestMove = Move(static_cast<int>(data >> 32 & 63), static_cast<int>(data >> 38 & 63),
+                          static_cast<int>(data >> 44 & 31) - 1);
+    entry.depth = static_cast<int>(data >> 49 & 255) - 1;
+    entry.evalType = static_cast<int>(data >> 57 & 3);
+    entry.generation = static_cast<int>(data >> 59 & generationMask);
+    return entry;
+}
 
+U64 TranspositionTable::PositionKey() {
+    return Gamestate::Get().zobristKey ^ Parameters::Get().Key();
+}
+
+bool TranspositionTable::Probe(U64 key, Entry& entry) {
+    Bucket& bucket = buckets[key & bucketMask];
+
+    for (Slot& slot : bucket.slots) {
+        U64 data = slot.data.load(std::memory_order_relaxed);
+        if ((slot.keyXorData.load(std::memory_order_relaxed) ^ data) != key || !data) continue;
+
+        entry = Unpack(data);
+        if (entry.depth < 0) return false;
+
+        int current = generation.load(std::memory_order_relaxed) & generationMask;
+        if (entry.generation != current) {
+            entry.generation = current;
+            data = Pack(entry);
+            slot.data.store(data, std::memory_order_relaxed);
+            slot.keyXorData.store(key ^ data, std::memory_order_relaxed);
+        }
+        return true;
+    }
+    return false;
+}
+
+TranspositionTable::Slot& TranspositionTable::Replace(U64 key) {
+    Bucket& bucket = buckets[key & bucketMask];
+    Slot* replace = &bucket.slots[0];
+    int replaceScore = INT32_MAX;
+    int current = generation.load(std::memory_order_relaxed);
+
+    for (Slot& slot : bucket.slots) {
+        U64 data = slot.data.load(std::memory_order_relaxed);
+        if ((slot.keyXorData.load(std::memory_order_relaxed) ^ data) == key) {
+            return slot;
+        }
+
+        // Prefer to overwrite entries left over from old searches, then the shallowest
+        Entry entry = Unpack(data);
+        int age = (current - entry.generation) & generationMask;
+        int score = entry.depth - 8 * age;
+        if (score < replaceScore) {
+            replace = &slot;
+            replaceScore = score;
+        }
+    }
+    return *replace;
 }
 
 int TranspositionTable::Lookup(int searchDepth, int depthFromRoot, int alpha, int beta) {
+    PROFILE_SCOPE(TTProbe);
     if (!useTable) return LookUpFailed;
 
-    Gamestate::Get().zobristKey = Zobrist::Get().GenerateKey();
-    Entry position = positions[Gamestate::Get().zobristKey];
+    SearchStats& stats = SearchStats::Get();
+    ++stats.ttProbes;
 
-    if (!position.isInitialized || position.depth < searchDepth) {
+    Entry position;
+    if (!Probe(PositionKey(), position)) {
+        return LookUpFailed;
+    }
+    ++stats.ttHits;
+    if (position.depth < searchDepth) {
         return LookUpFailed;
     }
 
@@ -35,24 +142,33 @@ int TranspositionTable::Lookup(int searchDepth, int depthFromRoot, int alpha, in
 }
 
 void TranspositionTable::StorePosition(int depth, int depthFromRoot, int evaluation, EvaluationType type, Move move) {
+    PROFILE_SCOPE(TTStore);
     if (!useTable) return;
 
-    Gamestate::Get().zobristKey = Zobrist::Get().GenerateKey();
-    Entry* position = &positions[Gamestate::Get().zobristKey];
+    U64 key = PositionKey();
+    Slot& slot = Replace(key);
+
+    Entry position;
+    position.evaluation = AdjustStoredMateEval(evaluation, depthFromRoot);
+    position.evalType = type;
+    position.bestMove = move;
+    position.depth = depth;
+    position.generation = generation.load(std::memory_order_relaxed);
 
-    evaluation = AdjustStoredMateEval(evaluation, depthFromRoot);
+    U64 data = Pack(position);
+    slot.data.store(data, std::memory_order_relaxed);
+    slot.keyXorData.store(key ^ data, std::memory_order_relaxed);
+}
 
-    position->evaluation = evaluation;
-    position->evalType = type;
-    position->bestMove = move;
-    position->depth = depth;
-    position->isInitialized = true;
-    position->age = Gamestate::Get().moveLog.size();
+Move TranspositionTable::GetBestMove() {
+    Entry position;
+    if (!useTable || !Probe(PositionKey(), position)) return {};
+    return position.bestMove;
 }
 
 
 int TranspositionTable::AdjustLookupMateEval(int eval, int depthFromRoot) {
-    if (isMateEval(eval)) {
+    if (isMateEval(eval) || isTablebaseEval(eval)) {
         int sign = eval > 0 ? 1 : -1;
         eval = (eval * sign - depthFromRoot) * sign;
     }
@@ -60,7 +176,7 @@ int TranspositionTable::AdjustLookupMateEval(int eval, int depthFromRoot) {
 }
 
 int TranspositionTable::AdjustStoredMateEval(int eval, int depthFromRoot) {
-    if (isMateEval(eval)) {
+    if (isMateEval(eval) || isTablebaseEval(eval)) {
         int sign = eval > 0 ? 1 : -1;
         eval = (eval * sign + depthFromRoot) * sign;
     }
@@ -9,8 +9,9 @@
 #include "move.h"
 #include "gamestate.h"
 #include "Zobrist.h"
-#include <random>
-#include <unordered_map>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 
 
 enum EvaluationType {Exact, BestCase, WorstCase};
@@ -20,6 +21,13 @@ inline bool isMateEval(int eval) {
     return std::abs(eval) > INT32_MAX - 999;
 }
 
+// Tablebase results count plies from the root like mates, in a band above any bitbase score
+inline const int TablebaseWin = 100000;
+
+inline bool isTablebaseEval(int eval) {
+    return std::abs(eval) > TablebaseWin - 999 && std::abs(eval) <= TablebaseWin;
+}
+
 class TranspositionTable {
 private:
     TranspositionTable();
@@ -28,45 +36,54 @@ private:
     int AdjustStoredMateEval(int eval, int depthFromRoot);
 
     struct Entry {
-        int evaluation;
-        EvaluationType evalType;
+        int evaluation = 0;
         Move bestMove;
-        int depth;
-        int age;
+        int depth = -1;
+        int generation = 0;
+        int evalType = Exact;
+    };
 
-        bool isInitialized = false;
+    // Search threads share the table without locks. The key is stored xor'ed with the packed entry,
+    // so a slot torn by two threads writing at once no longer matches its key and reads as a miss.
+    struct Slot {
+        std::atomic<U64> keyXorData = 0;
+        std::atomic<U64> data = 0;
     };
 
+    // One bucket fills a cache line, so a probe touches memory only once
+    struct alignas(64) Bucket {
+        Slot slots[4];
+    };
+
+    static const int generationMask = 31;
+
+    static U64 Pack(const Entry& entry);
+    static Entry Unpack(U64 data);
+
+    // Searches made with other parameters see different positions
+    static U64 PositionKey();
+    bool Probe(U64 key, Entry& entry);
+    Slot& Replace(U64 key);
+
+    std::unique_ptr<Bucket[]> buckets;
+    U64 bucketMask;
+    std::atomic<int> generation = 0;
+
 public:
     static TranspositionTable& Get() {
         static TranspositionTable instance;
         return instance;
     }
 
+    void Resize(int megabytes);
+    void Clear();
+    void NewSearch();
+
     int Lookup(int searchDepth, int depthFromRoot, int alpha, int beta);
     void StorePosition(int depth, int depthFromRoot, int evaluation, EvaluationType type, Move move);
+    Move GetBestMove();
 
-    std::unordered_map<U64, Entry> positions;
-
-    bool useTable = false;
+    bool useTable = true;
 };
 
-inline void CleanUp(TranspositionTable* tt) {
-    if (!tt->useTable) return;
-
-    while (Gamestate::Get().result == Pending) {
-        const int age = Gamestate::Get().moveLog.size() - 5;
-        if (tt->positions.empty()) {
-            continue;
-        }
-        auto it = tt->positions.begin();
-        while (it != tt->positions.end()) {
-            if (it->second.age < age) {
-                tt->positions.erase(it);
-                ++it;
-            }
-        }
-    }
-}
-
 #endif //CHESS_ENGINE_TRANSPOSITION_H
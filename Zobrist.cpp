@@ -40,8 +40,7 @@ Zobrist::Zobrist() {
                      randBit15() >> 4;
 }
 
-U64 Zobrist::GenerateKey() {
-    Gamestate& gamestate = Gamestate::Get();
+U64 Zobrist::GenerateKey(const Gamestate& gamestate) {
     U64 key = 0;
 
     for (int square = 0; square < 64; ++square) {
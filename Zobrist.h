@@ -23,7 +23,7 @@ public:
         return instance;
     }
 
-    U64 GenerateKey();
+    U64 GenerateKey(const Gamestate& gamestate = Gamestate::Get());
 
     std::array<std::array<U64, 12>, 64> pieceKeys;
     std::array<U64, 16> castlingKeys;
@@ -54,4 +54,22 @@ U64 BitMasks::xRay(int fromSquare, int thruSquare, U64 occSquares) {
         row += verticalDirection;
         col += horizontalDirection;
     }
+}
+
+U64 BitMasks::northFill(U64 bitboard) {
+    bitboard |= bitboard << 8;
+    bitboard |= bitboard << 16;
+    bitboard |= bitboard << 32;
+    return bitboard;
+}
+
+U64 BitMasks::southFill(U64 bitboard) {
+    bitboard |= bitboard >> 8;
+    bitboard |= bitboard >> 16;
+    bitboard |= bitboard >> 32;
+    return bitboard;
+}
+
+U64 BitMasks::fileFill(U64 bitboard) {
+    return northFill(bitboard) | southFill(bitboard);
 }
\ No newline at end of file
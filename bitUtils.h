@@ -18,6 +18,10 @@ namespace BitUtils {
 namespace BitMasks {
     U64 segmentMask(int fromSquare, int toSquare);
     U64 xRay(int fromSquare, int thruSquare, U64 occSquares);
+
+    U64 northFill(U64 bitboard);
+    U64 southFill(U64 bitboard);
+    U64 fileFill(U64 bitboard);
 }
 
 #endif //CHESS_ENGINE_BITUTILS_H
@@ -5,66 +5,92 @@
 #include "evaluation.h"
 #include "bitUtils.h"
 #include "movegen.h"
+#include "PawnHash.h"
+#include "EvalCache.h"
+#include "Parameters.h"
+#include "Profile.h"
+#include "NNUE.h"
+#include "Bitbase.h"
 #include <cmath>
 
 
 int Evaluator::StaticEvaluation() {
+    PROFILE_SCOPE(StaticEvaluation);
     ++callCount;
     Gamestate& gamestate = Gamestate::Get();
 
     if (gamestate.result == Draw) return 0;
 
-    int perspective = gamestate.whiteToMove ? 1 : -1;
+    // The key includes the side to move, so the cached score is already from its perspective
+    U64 key = gamestate.zobristKey ^ Parameters::Get().Key();
+    int eval;
+    if (EvalCache::Get().Probe(key, eval)) return eval;
 
-    /* Count Material */
-    CountMaterial();
+    if (NNUE::Get().IsActive()) {
+        eval = NNUE::Get().Evaluate();
+    } else {
+        int perspective = gamestate.whiteToMove ? 1 : -1;
+
+        /* Count Material */
+        CountMaterial();
+
+        Score score = material + EvaluatePcSqTables() + EvaluateStructure() +
+                      EvaluateMobility() + EvaluateKingAttacks() + EvaluateSpace();
+        eval = Taper(score) + MopUpEvaluation();
+        eval *= perspective;
+    }
+
+    // The evaluation still orders won positions, which keeps the engine making progress towards mate
+    int bitbaseResult;
+    if (Bitbases::Get().Probe(gamestate, bitbaseResult)) {
+        eval = bitbaseResult == 0 ? 0 : bitbaseResult * KnownWin + eval;
+    }
+
+    EvalCache::Get().Store(key, eval);
+    return eval;
+}
 
-    int eval = material + EvaluatePcSqTables() + MopUpEvaluation() + EvaluateMobility() + EvaluateStructure();
-    return perspective * eval;
+int Evaluator::UntunedTerms() {
+    CountMaterial();
+    return MopUpEvaluation();
 }
 
 void Evaluator::CountMaterial() {
     Gamestate& gamestate = Gamestate::Get();
-    material = 0;
-
-    int current_pawn_val = (1- gamestate.gamePhase) * PieceValues::midGamePawn + gamestate.gamePhase * PieceValues::endGamePawn;
-    int current_knight_val = (1- gamestate.gamePhase) * PieceValues::midGameKnight + gamestate.gamePhase * PieceValues::endGameKnight;
-    int current_bishop_val = (1- gamestate.gamePhase) * PieceValues::midGameBishop + gamestate.gamePhase * PieceValues::endGameBishop;
-    int current_rook_val = (1- gamestate.gamePhase) * PieceValues::midGameRook + gamestate.gamePhase * PieceValues::endGameRook;
-    int current_queen_val = (1- gamestate.gamePhase) * PieceValues::midGameQueen + gamestate.gamePhase * PieceValues::endGameQueen;
-
-    material += current_pawn_val * (bit_cnt(gamestate.w_pawn) - bit_cnt(gamestate.b_pawn));
-    material += current_knight_val * (bit_cnt(gamestate.w_knight) - bit_cnt(gamestate.b_knight));
-    material += current_bishop_val * (bit_cnt(gamestate.w_bishop) - bit_cnt(gamestate.b_bishop));
-    material += current_rook_val * (bit_cnt(gamestate.w_rook) - bit_cnt(gamestate.b_rook));
-    material += current_queen_val * (bit_cnt(gamestate.w_queen) - bit_cnt(gamestate.b_queen));
+
+    material = PieceValues::values[0] * (bit_cnt(gamestate.w_pawn) - bit_cnt(gamestate.b_pawn));
+    material += PieceValues::values[1] * (bit_cnt(gamestate.w_knight) - bit_cnt(gamestate.b_knight));
+    material += PieceValues::values[2] * (bit_cnt(gamestate.w_bishop) - bit_cnt(gamestate.b_bishop));
+    material += PieceValues::values[3] * (bit_cnt(gamestate.w_rook) - bit_cnt(gamestate.b_rook));
+    material += PieceValues::values[4] * (bit_cnt(gamestate.w_queen) - bit_cnt(gamestate.b_queen));
 }
 
-int Evaluator::EvaluatePcSqTables() {
+Score Evaluator::EvaluatePcSqTables() {
     Gamestate& gamestate = Gamestate::Get();
-    int value = 0;
+    Score value = 0;
     U64 bitboard;
 
     for (int piece = 0; piece < 12; ++piece) {
         bitboard = *gamestate.bitboards[piece];
         while (bitboard) {
-            int square = popLSB(bitboard);
-            value += (1 - gamestate.gamePhase) * PcSqTables::midGameTables[piece][square] +
-                           gamestate.gamePhase * PcSqTables::endGameTables[piece][square];
+            value += PcSqTables::packedTables[piece][popLSB(bitboard)];
         }
     }
     return value;
 }
 
 int Evaluator::MopUpEvaluation() {
+    const int lateEndgame = GamePhase::endgame * 3 / 4;
     int value = 0;
     Gamestate& gamestate = Gamestate::Get();
 
-    if (Gamestate::Get().gamePhase > 0.75 && material >= 500) {
+    int balance = Taper(material);
+
+    if (gamestate.gamePhase > lateEndgame && balance >= 500) {
         value += 10 * PcSqTables::centerManhattanDistance[squareOf(gamestate.b_king)];
         value -= 4 * ManhattanDistance(squareOf(gamestate.w_king), squareOf(gamestate.b_king));
         value -= 10 * PcSqTables::centerManhattanDistance[squareOf(gamestate.w_king)];
-    } else if (Gamestate::Get().gamePhase > 0.75 && material <= -500) {
+    } else if (gamestate.gamePhase > lateEndgame && balance <= -500) {
         value -= 10 * PcSqTables::centerManhattanDistance[squareOf(gamestate.w_king)];
         value += 4 * ManhattanDistance(squareOf(gamestate.w_king), squareOf(gamestate.b_king));
         value += 10 * PcSqTables::centerManhattanDistance[squareOf(gamestate.b_king)];
@@ -86,38 +112,64 @@ int Evaluator::MopUpEvaluation() {
     return Gamestate::Get().whiteToMove ? value : -value;
 }
 
-int Evaluator::EvaluateMobility() {
+Score Evaluator::EvaluateMobility() {
     Gamestate& gamestate = Gamestate::Get();
-    int value = 50 * log2(MoveGenerator::Get().CountLegalMoves());
+    MoveGenerator& moveGenerator = MoveGenerator::Get();
+    const Parameters& parameters = Parameters::Get();
+    moveGenerator.CalculateAttackMaps();
+
+    Score mobility = S(parameters.mobilityMidGame, parameters.mobilityEndGame);
+    Score blockedCenterPawn = S(parameters.blockedCenterPawnMidGame, parameters.blockedCenterPawnEndGame);
+
+    Score value = mobility * (moveGenerator.mobility[0] - moveGenerator.mobility[1]);
 
     // Placing a piece in front of a central pawn before it has moves is bad.
-    value += 50 * bit_cnt(~gamestate.empty_sqs & (1ULL << Board::Squares::d6 | 1ULL << Board::Squares::e6) & gamestate.b_pawn >> 8);
-    value -= 50 * bit_cnt(gamestate.all_pieces & (1ULL << Board::Squares::d3 | 1ULL << Board::Squares::e3) & gamestate.w_pawn << 8);
+    value += blockedCenterPawn * bit_cnt(~gamestate.empty_sqs & (1ULL << Board::Squares::d6 | 1ULL << Board::Squares::e6) & gamestate.b_pawn >> 8);
+    value -= blockedCenterPawn * bit_cnt(gamestate.all_pieces & (1ULL << Board::Squares::d3 | 1ULL << Board::Squares::e3) & gamestate.w_pawn << 8);
 
     return value;
 }
 
-int Evaluator::EvaluateStructure() {
+Score Evaluator::EvaluateKingAttacks() {
     Gamestate& gamestate = Gamestate::Get();
-    U64 open_files = 0, w_half_open = 0, b_half_open = 0, file;
-    int value = 0;
+    const MoveGenerator& moveGenerator = MoveGenerator::Get();
 
-    for (int shift = 0; shift < 8; ++shift) {
-        file = Board::Files::aFile << shift;
+    U64 whiteKingZone = moveGenerator.attacksBy[5] | gamestate.w_king;
+    U64 blackKingZone = moveGenerator.attacksBy[11] | gamestate.b_king;
+    int attackedSquares = 0;
 
-        if (!(file & gamestate.w_pawn)) {
-            w_half_open ^= file;
-        }
-        if (!(file & gamestate.b_pawn)) {
-            b_half_open ^= file;
-        }
+    for (int piece = 1; piece <= 4; ++piece) {
+        attackedSquares += bit_cnt(moveGenerator.attacksBy[piece] & blackKingZone);
+        attackedSquares -= bit_cnt(moveGenerator.attacksBy[piece + 6] & whiteKingZone);
     }
-    open_files = w_half_open & b_half_open;
+    const Parameters& parameters = Parameters::Get();
+    return S(parameters.kingAttackMidGame, parameters.kingAttackEndGame) * attackedSquares;
+}
+
+Score Evaluator::EvaluateSpace() {
+    Gamestate& gamestate = Gamestate::Get();
+    const MoveGenerator& moveGenerator = MoveGenerator::Get();
+
+    const U64 centerFiles = Board::Files::cFile | Board::Files::dFile | Board::Files::eFile | Board::Files::fFile;
+    const U64 whiteHalf = Board::Ranks::rank_2 | Board::Ranks::rank_3 | Board::Ranks::rank_4;
+    const U64 blackHalf = Board::Ranks::rank_5 | Board::Ranks::rank_6 | Board::Ranks::rank_7;
+
+    U64 whiteSpace = centerFiles & whiteHalf & ~gamestate.w_pawn & ~moveGenerator.attacksBy[6] & moveGenerator.attacks[0];
+    U64 blackSpace = centerFiles & blackHalf & ~gamestate.b_pawn & ~moveGenerator.attacksBy[0] & moveGenerator.attacks[1];
+
+    const Parameters& parameters = Parameters::Get();
+    return S(parameters.spaceMidGame, parameters.spaceEndGame) * (bit_cnt(whiteSpace) - bit_cnt(blackSpace));
+}
 
-    value += 10 * bit_cnt(gamestate.w_rook & w_half_open);
-    value -= 10 * bit_cnt(gamestate.b_rook & b_half_open);
-    value += 20 * bit_cnt(gamestate.w_rook & open_files);
-    value -= 20 * bit_cnt(gamestate.b_rook & open_files);
+Score Evaluator::EvaluateStructure() {
+    Gamestate& gamestate = Gamestate::Get();
+    const PawnEntry& pawns = PawnHashTable::Get().Probe();
+    Score value = pawns.score;
+
+    value += PawnWeights::rookHalfOpenFile * bit_cnt(gamestate.w_rook & pawns.halfOpenFiles[0]);
+    value -= PawnWeights::rookHalfOpenFile * bit_cnt(gamestate.b_rook & pawns.halfOpenFiles[1]);
+    value += PawnWeights::rookOpenFile * bit_cnt(gamestate.w_rook & pawns.openFiles);
+    value -= PawnWeights::rookOpenFile * bit_cnt(gamestate.b_rook & pawns.openFiles);
 
     return value;
 }
@@ -146,4 +198,16 @@ std::array<int, 64> NegateTable(const std::array<int, 64> table) {
         negativeTable[square] = -table[square];
     }
     return negativeTable;
+}
+
+std::array<std::array<Score, 64>, 12> PackTables(const std::array<std::array<int, 64>, 12>& midGameTables,
+                                                 const std::array<std::array<int, 64>, 12>& endGameTables) {
+    std::array<std::array<Score, 64>, 12> packedTables;
+
+    for (int piece = 0; piece < 12; ++piece) {
+        for (int square = 0; square < 64; ++square) {
+            packedTables[piece][square] = S(midGameTables[piece][square], endGameTables[piece][square]);
+        }
+    }
+    return packedTables;
 }
\ No newline at end of file
@@ -7,32 +7,60 @@
 
 #include "gamestate.h"
 #include <array>
+#include <cstdint>
 
+// A mid game and an end game value packed into one int, the end game half on top.
+// Packed scores add and subtract as plain ints and are tapered once.
+typedef int Score;
+
+constexpr Score S(int midGame, int endGame) {
+    return static_cast<int>(static_cast<unsigned>(endGame) << 16) + midGame;
+}
+
+inline int MidGameValue(Score score) {
+    return static_cast<int16_t>(static_cast<uint16_t>(static_cast<unsigned>(score)));
+}
+
+inline int EndGameValue(Score score) {
+    return static_cast<int16_t>(static_cast<uint16_t>((static_cast<unsigned>(score) + 0x8000) >> 16));
+}
+
+inline int Taper(Score score) {
+    int phase = Gamestate::Get().gamePhase;
+    return (MidGameValue(score) * (GamePhase::endgame - phase) + EndGameValue(score) * phase) / GamePhase::endgame;
+}
 
 class Evaluator {
 private:
     Evaluator();
 
     void CountMaterial();
-    int EvaluatePcSqTables();
+    Score EvaluatePcSqTables();
     int MopUpEvaluation();
-    int EvaluateMobility();
-    int EvaluateStructure();
+    Score EvaluateMobility();
+    Score EvaluateKingAttacks();
+    Score EvaluateSpace();
+    Score EvaluateStructure();
 
-    int material;
+    Score material;
 
 public:
     static Evaluator& Get() {
-        static Evaluator instance;
+        static thread_local Evaluator instance;
         return instance;
     }
 
     int StaticEvaluation();
     int callCount;
+
+    // The terms the tuner doesn't model, from white's point of view
+    int UntunedTerms();
 };
 
 std::array<int, 64> FlipTable(const std::array<int, 64> table);
 std::array<int, 64> NegateTable(const std::array<int, 64> table);
+std::array<std::array<Score, 64>, 12> PackTables(const std::array<std::array<int, 64>, 12>& midGameTables,
+                                                 const std::array<std::array<int, 64>, 12>& endGameTables);
 
 namespace PieceValues {
     const int midGamePawn = 82;
@@ -48,35 +76,30 @@ namespace PieceValues {
     const int endGameQueen = 936;
     const int king = 0;
 
-    const int midGameValues[12] = {
-            midGamePawn,
-            midGameKnight,
-            midGameBishop,
-            midGameRook,
-            midGameQueen,
-            king,
-            -midGamePawn,
-            -midGameKnight,
-            -midGameBishop,
-            -midGameRook,
-            -midGameQueen,
-            -king,
+    const Score values[12] = {
+            S(midGamePawn, endGamePawn),
+            S(midGameKnight, endGameKnight),
+            S(midGameBishop, endGameBishop),
+            S(midGameRook, endGameRook),
+            S(midGameQueen, endGameQueen),
+            S(king, king),
+            -S(midGamePawn, endGamePawn),
+            -S(midGameKnight, endGameKnight),
+            -S(midGameBishop, endGameBishop),
+            -S(midGameRook, endGameRook),
+            -S(midGameQueen, endGameQueen),
+            -S(king, king),
     };
+}
 
-    const int endGameValues[12] = {
-            endGamePawn,
-            endGameKnight,
-            endGameBishop,
-            endGameRook,
-            endGameQueen,
-            king,
-            -endGamePawn,
-            -endGameKnight,
-            -endGameBishop,
-            -endGameRook,
-            -endGameQueen,
-            -king,
-    };
+// Added to positions the bitbases prove won, so they outrank any ordinary advantage but not a mate
+inline const int KnownWin = 10000;
+
+namespace ActivityWeights {
+    const Score mobility = S(4, 3);   // per safe square a knight, bishop, rook or queen can reach
+    const Score kingAttack = S(8, 0); // per attacked square next to the enemy king, counted once per piece type
+    const Score space = S(3, 0);      // per safe central square in our own half that we attack
+    const Score blockedCenterPawn = S(50, 50);
 }
 
 namespace PcSqTables {
@@ -252,11 +275,12 @@ namespace PcSqTables {
             NegateTable(endGameQueen),
             NegateTable(endGameKing),
     };
+
+    inline const std::array<std::array<Score, 64>, 12> packedTables = PackTables(midGameTables, endGameTables);
 }
 
 inline int EvaluatePiece(int piece) {
-    return std::abs((1- Gamestate::Get().gamePhase) * PieceValues::midGameValues[PieceNum2BitboardIndex.at(piece)] +
-                         Gamestate::Get().gamePhase * PieceValues::endGameValues[PieceNum2BitboardIndex.at(piece)]);
+    return std::abs(Taper(PieceValues::values[PieceNum2BitboardIndex.at(piece)]));
 }
 
 inline int ManhattanDistance(int square1, int square2) {
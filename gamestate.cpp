@@ -7,17 +7,46 @@
 #include "bitUtils.h"
 #include "Zobrist.h"
 #include "Transposition.h"
+#include "NNUE.h"
+#include "Profile.h"
 
 Gamestate::Gamestate() {
+    undoHistory.reserve(1024);
     Seed();
 }
 
 void Gamestate::Seed(const std::string& position) {
     legality = 0;
+    halfmoveClock = 0;
+    startingPosition = position;
     InitFENString(position);
     InitBitboards();
     while(!moveLog.empty()) moveLog.pop();
-    while(!legalityHistory.empty()) legalityHistory.pop();
+    undoHistory.clear();
+    zobristKey = Zobrist::Get().GenerateKey(*this); // Get() isn't usable while constructing
+    NNUE::Get().Reset();
+    result = Pending;
+}
+
+int Gamestate::RepetitionCount() const {
+    // Nothing from before the last irreversible move can come back, and only every other ply has the same side to move
+    int count = 0;
+    int plies = std::min<int>(halfmoveClock, static_cast<int>(undoHistory.size()));
+    for (int back = 4; back <= plies; back += 2) {
+        if (undoHistory[undoHistory.size() - back].zobristKey == zobristKey) ++count;
+    }
+    return count;
+}
+
+std::vector<Move> Gamestate::MoveHistory() const {
+    std::stack<Move> log = moveLog;
+    std::vector<Move> history(log.size());
+
+    for (auto move = history.rbegin(); move != history.rend(); ++move) {
+        *move = log.top();
+        log.pop();
+    }
+    return history;
 }
 
 void Gamestate::InitFENString(const std::string &position) {
@@ -89,6 +118,15 @@ void Gamestate::InitFENString(const std::string &position) {
                 break;
 
             case HalfMoveClock:
+                if (c == ' ') {
+                    ++currentField;
+                    break;
+                }
+                if (isnumber(c)) {
+                    halfmoveClock = 10 * halfmoveClock + c - '0';
+                }
+                break;
+
             case FullMoveCount:
             default:
                 break;
@@ -108,17 +146,30 @@ void Gamestate::InitBitboards() {
     b_pieces = b_pawn | b_knight | b_bishop | b_rook | b_queen | b_king;
     all_pieces = w_pieces | b_pieces;
     empty_sqs = ~all_pieces;
+
+    phaseMaterial = 0;
+    pawnKey = 0;
+    for (int square = 0; square < 64; ++square) {
+        phaseMaterial += GamePhase::pieceWeights[mailbox[square] & 0b0111];
+        if ((mailbox[square] & 0b0111) == 1) {
+            pawnKey ^= Zobrist::Get().pieceKeys[square][PieceNum2BitboardIndex.at(mailbox[square])];
+        }
+    }
+    gamePhase = GamePhase::FromMaterial(phaseMaterial);
 }
 
 void Gamestate::MakeMove(Move move) {
-    legalityHistory.push(legality);
+    PROFILE_SCOPE(MakeMove);
+    if (NNUE::Get().IsActive()) NNUE::Get().Push(move, *this);
+
+    undoHistory.push_back({legality, halfmoveClock, pawnKey, zobristKey, result});
     moveLog.push(move);
 
     int movingPiece = mailbox[move.startSquare];
     int capturedPiece = mailbox[move.endSquare];
     U64 moveSquares = (1ULL << move.startSquare | 1ULL << move.endSquare);
 
-    legality = legalityHistory.top() & legalityBits::castleMask;
+    legality = undoHistory.back().legality & legalityBits::castleMask;
     legality |= capturedPiece << legalityBits::capturedPieceShift;
 
     switch (move.flag) {
@@ -220,6 +271,19 @@ void Gamestate::MakeMove(Move move) {
             break;
     }
 
+    if ((movingPiece & 0b0111) == 1) {
+        pawnKey ^= Zobrist::Get().pieceKeys[move.startSquare][PieceNum2BitboardIndex.at(movingPiece)];
+        if (!(move.flag & MoveFlags::promotion)) {
+            pawnKey ^= Zobrist::Get().pieceKeys[move.endSquare][PieceNum2BitboardIndex.at(movingPiece)];
+        }
+        if (move.flag == MoveFlags::enPassant) {
+            pawnKey ^= Zobrist::Get().pieceKeys[8 * (move.startSquare / 8) + move.endSquare % 8][PieceNum2BitboardIndex.at(movingPiece ^ 0b1000)];
+        }
+    }
+    if ((capturedPiece & 0b0111) == 1) {
+        pawnKey ^= Zobrist::Get().pieceKeys[move.endSquare][PieceNum2BitboardIndex.at(capturedPiece)];
+    }
+
     if (movingPiece == 6) {
         legality &= ~legalityBits::whiteCanCastleMask;
     } else if (movingPiece == 14) {
@@ -236,31 +300,33 @@ void Gamestate::MakeMove(Move move) {
     all_pieces = w_pieces | b_pieces;
     empty_sqs = ~all_pieces;
 
-    gamePhase = 1 - (float(bit_cnt(MinorPieces()) + 2 * bit_cnt(MajorPieces())) / 20);
+    if (capturedPiece) phaseMaterial -= GamePhase::pieceWeights[capturedPiece & 0b0111];
+    if (move.flag >= MoveFlags::knightPromotion) {
+        phaseMaterial += GamePhase::pieceWeights[(move.flag & 0b11) + 2];
+    }
+    gamePhase = GamePhase::FromMaterial(phaseMaterial);
 
     //TranspositionTable::Get().useTable = (gamePhase > 0.75);
 
     whiteToMove = !whiteToMove;
 
+    halfmoveClock = (movingPiece & 0b0111) == 1 || capturedPiece || move.flag == MoveFlags::enPassant ? 0 : halfmoveClock + 1;
+
     zobristKey = Zobrist::Get().GenerateKey();
-    threefoldHistory[zobristKey] += 1;
-    if (threefoldHistory[zobristKey] == 3) {
+    if (halfmoveClock >= 100 || RepetitionCount() >= 2) {
         result = Draw;
     }
 }
 
 void Gamestate::UndoMove() {
+    PROFILE_SCOPE(UndoMove);
     Move move = moveLog.top();
 
     int movingPiece = mailbox[move.endSquare];
     int capturedPiece = (legality & legalityBits::capturedPieceMask) >> legalityBits::capturedPieceShift;
     U64 moveSquares = (1ULL << move.startSquare | 1ULL << move.endSquare);
 
-    zobristKey = Zobrist::Get().GenerateKey();
-    threefoldHistory[zobristKey] -= 1;
-    if (threefoldHistory[zobristKey] == 2) {
-        result = Pending;
-    }
+    if (NNUE::Get().IsActive()) NNUE::Get().Pop();
 
     switch (move.flag) {
         case MoveFlags::nullMove:
@@ -370,16 +436,25 @@ void Gamestate::UndoMove() {
             break;
     }
 
-    legality = legalityHistory.top();
+    const UndoInfo& undo = undoHistory.back();
+    legality = undo.legality;
+    halfmoveClock = undo.halfmoveClock;
+    pawnKey = undo.pawnKey;
+    zobristKey = undo.zobristKey;
+    result = undo.result;
     moveLog.pop();
-    legalityHistory.pop();
+    undoHistory.pop_back();
 
     w_pieces = w_pawn | w_knight | w_bishop | w_rook | w_queen | w_king;
     b_pieces = b_pawn | b_knight | b_bishop | b_rook | b_queen | b_king;
     all_pieces = w_pieces | b_pieces;
     empty_sqs = ~all_pieces;
 
-    gamePhase = 1 - (float(bit_cnt(MinorPieces()) + 2 * bit_cnt(MajorPieces())) / 20);
+    if (capturedPiece) phaseMaterial += GamePhase::pieceWeights[capturedPiece & 0b0111];
+    if (move.flag >= MoveFlags::knightPromotion) {
+        phaseMaterial -= GamePhase::pieceWeights[(move.flag & 0b11) + 2];
+    }
+    gamePhase = GamePhase::FromMaterial(phaseMaterial);
 
     //TranspositionTable::Get().useTable = (gamePhase > 0.75);
 
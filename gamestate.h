@@ -11,6 +11,7 @@
 #include <vector>
 #include <unordered_map>
 #include <stack>
+#include <algorithm>
 
 typedef uint64_t U64;
 
@@ -38,10 +39,32 @@ namespace legalityBits {
     const int enPassantLegalMask = 0b100000000000;
 }
 
+namespace GamePhase {
+    const int opening = 0;
+    const int endgame = 256;
+
+    // Minor pieces count 1 and major pieces 2, a full board holds 20
+    const int pieceWeights[8] = {0, 0, 1, 1, 2, 2, 0, 0};
+    const int startingMaterial = 20;
+
+    inline int FromMaterial(int material) {
+        return endgame - std::min(material, startingMaterial) * endgame / startingMaterial;
+    }
+}
+
 enum Result {
     BlackWin, Draw, WhiteWin, Pending
 };
 
+// What MakeMove overwrites and UndoMove has to put back, one entry per ply played
+struct UndoInfo {
+    int legality;
+    int halfmoveClock;
+    U64 pawnKey;
+    U64 zobristKey;
+    Result result;
+};
+
 class Gamestate {
 private:
     Gamestate();
@@ -51,7 +74,8 @@ public:
     Gamestate(const Gamestate&) = delete;
 
     static Gamestate& Get() {
-        static Gamestate instance;
+        // Each thread owns a position, so a search can run off of the GUI thread
+        static thread_local Gamestate instance;
         return instance;
     }
 
@@ -60,6 +84,12 @@ public:
     void MakeMove(Move move);
     void UndoMove();
 
+    std::vector<Move> MoveHistory() const;
+
+    // Earlier occurrences of the current position since the last capture or pawn move
+    int RepetitionCount() const;
+    bool IsRepetition() const { return RepetitionCount() > 0; }
+
     std::array<int, 64> mailbox;
     U64 w_pawn, w_knight, w_bishop, w_rook, w_queen, w_king;
     U64 b_pawn, b_knight, b_bishop, b_rook, b_queen, b_king;
@@ -83,17 +113,21 @@ public:
 
     int legality;
 
+    std::string startingPosition;
     std::stack<Move> moveLog;
-    std::stack<int> legalityHistory;
-    std::unordered_map<U64, int> threefoldHistory;
+    std::vector<UndoInfo> undoHistory;
+
+    int halfmoveClock = 0; // plies since the last capture or pawn move
 
     Result result = Pending;
 
     bool whiteToMove;
 
-    float gamePhase;
+    int gamePhase; // GamePhase::opening up to GamePhase::endgame
+    int phaseMaterial;
 
     U64 zobristKey;
+    U64 pawnKey; // hashes only the pawns, updated incrementally
 };
 
 const std::unordered_map<char, int> PieceChar2Number = {
@@ -7,6 +7,10 @@
 #include "bitUtils.h"
 #include "evaluation.h"
 #include "Transposition.h"
+#include "NNUE.h"
+#include "Book.h"
+#include "Bitbase.h"
+#include "Tablebase.h"
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -16,13 +20,17 @@
 int main() {
     Gamestate& gamestate = Gamestate::Get();
     MovementTables::LoadTables();
+    // Falls back to the hand written evaluation without a network
+    NNUENetwork::Get().Load("nnue.bin");
+    OpeningBook::Get().Open("book.bin");
+    // Generated on the first run, read back from the cache afterwards
+    Bitbases::Get().Init("bitbases.bin");
+    Tablebases::Get().Init("tablebases");
     GUI& gui = GUI::Get();
-    TranspositionTable& tt = TranspositionTable::Get();
     SDL_Event event;
     //SearchTest::TestSearch();
     gamestate.Seed(/*"r1bqk2r/ppppbppp/2nn4/1B2N3/8/8/PPPP1PPP/RNBQR1K1 w kq - 1 7"*/);
     gamestate.zobristKey = Zobrist::Get().GenerateKey();
-    std::thread ttCleaner (CleanUp, &tt);
 
     bool running = true;
     while (running) {
@@ -45,6 +53,5 @@ int main() {
         Bot::Get().PlayMove();
         MoveGenerator::Get().GenerateLegalMoves();
     }
-    ttCleaner.join();
     return 0;
 }
\ No newline at end of file
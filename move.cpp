@@ -4,6 +4,7 @@
 
 #include "move.h"
 #include "gamestate.h"
+#include "movegen.h"
 
 
 Move::Move(int fromSquare, int toSquare, int moveFlag) {
@@ -59,3 +60,68 @@ std::string PGNNotation(Move move) {
 
     return notation;
 }
+
+bool ParseSAN(const std::string& san, Move& move) {
+    Gamestate& gamestate = Gamestate::Get();
+    std::vector<Move> legalMoves = MoveGenerator::Get().GenerateLegalMoves();
+
+    std::string text = san;
+    while (!text.empty() && std::string("+#!?").find(text.back()) != std::string::npos) text.pop_back();
+
+    if (text == "O-O" || text == "0-0" || text == "O-O-O" || text == "0-0-0") {
+        int flag = text.size() == 3 ? MoveFlags::shortCastle : MoveFlags::longCastle;
+        for (Move legalMove : legalMoves) {
+            if (legalMove.flag == flag) {
+                move = legalMove;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int pieceType = 1;
+    if (!text.empty() && std::string("NBRQK").find(text.front()) != std::string::npos) {
+        pieceType = PieceChar2Number.at(text.front());
+        text.erase(0, 1);
+    }
+
+    int promotionType = 0;
+    size_t promotion = text.find('=');
+    if (promotion != std::string::npos) {
+        if (promotion + 1 >= text.size()) return false;
+        promotionType = PieceChar2Number.at(std::toupper(text[promotion + 1]));
+        text.erase(promotion);
+    } else if (!text.empty() && std::string("NBRQ").find(text.back()) != std::string::npos) {
+        promotionType = PieceChar2Number.at(text.back());
+        text.pop_back();
+    }
+
+    text.erase(std::remove(text.begin(), text.end(), 'x'), text.end());
+    if (text.size() < 2) return false;
+
+    int endFile = text[text.size() - 2] - 'a';
+    int endRank = text[text.size() - 1] - '1';
+    if (endFile < 0 || endFile > 7 || endRank < 0 || endRank > 7) return false;
+
+    // Whatever is left in front of the destination disambiguates the starting square
+    int startFile = -1, startRank = -1;
+    for (size_t i = 0; i + 2 < text.size(); ++i) {
+        if (text[i] >= 'a' && text[i] <= 'h') startFile = text[i] - 'a';
+        if (text[i] >= '1' && text[i] <= '8') startRank = text[i] - '1';
+    }
+
+    int matches = 0;
+    for (Move legalMove : legalMoves) {
+        if (legalMove.endSquare != 8 * endRank + endFile) continue;
+        if ((gamestate.mailbox[legalMove.startSquare] & 0b0111) != pieceType) continue;
+        if (startFile != -1 && legalMove.startSquare % 8 != startFile) continue;
+        if (startRank != -1 && legalMove.startSquare / 8 != startRank) continue;
+
+        int promotesTo = legalMove.flag >= MoveFlags::knightPromotion ? (legalMove.flag & 0b11) + 2 : 0;
+        if (promotesTo != promotionType) continue;
+
+        move = legalMove;
+        ++matches;
+    }
+    return matches == 1;
+}
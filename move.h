@@ -6,6 +6,7 @@
 #define CHESS_ENGINE_MOVE_H
 
 #include <string>
+#include <vector>
 
 namespace MoveFlags {
     const int quietMove = 0;
@@ -37,8 +38,16 @@ public:
     Move(int fromSquare = 0, int toSquare = 0, int moveFlag = MoveFlags::nullMove);
 };
 
+// One root move with its score for the side to move and the line the search expects after it
+struct SearchLine {
+    Move move;
+    int eval;
+    std::vector<Move> pv;
+};
+
 std::string AlgebraicNotation(Move move);
 std::string PGNNotation(Move move);
+bool ParseSAN(const std::string& san, Move& move); // matches against the current position's legal moves
 
 inline std::unordered_map<int, std::string> PieceNum2Char {
         {1, ""},
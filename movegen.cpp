@@ -4,8 +4,12 @@
 
 #include "movegen.h"
 #include "bitUtils.h"
+#include "Profile.h"
+#include "PerftTable.h"
 #include <vector>
 #include <cmath>
+#include <atomic>
+#include <thread>
 
 
 void MovementTables::LoadTables() {
@@ -89,9 +93,11 @@ MoveGenerator::MoveGenerator() {
 }
 
 std::vector<Move> MoveGenerator::GenerateLegalMoves(bool capturesOnly) {
+    PROFILE_SCOPE(GenerateLegalMoves);
     legalMoves.clear();
 
-    CalculateEnemyAttacks();
+    // The evaluation may have worked the enemy's attacks out for this position already
+    if (enemyAttacksKey != Gamestate::Get().zobristKey) CalculateEnemyAttacks();
     CalculateCheckMask();
     CalculatePinMasks();
 
@@ -124,139 +130,67 @@ std::vector<Move> MoveGenerator::GenerateLegalMoves(bool capturesOnly) {
     return legalMoves;
 }
 
-float MoveGenerator::CountLegalMoves() {
-    float whiteCount = 0, blackCount = 0;
-
-    Gamestate& gamestate = Gamestate::Get();
-
-    U64 whiteBishops = gamestate.w_bishop | gamestate.w_queen;
-    U64 blackBishops = gamestate.b_bishop | gamestate.b_queen;
-    U64 whiteRooks = gamestate.w_rook | gamestate.w_queen;
-    U64 blackRooks = gamestate.b_rook | gamestate.b_queen;
-    U64 whiteKnights = gamestate.w_knight;
-    U64 blackKnights = gamestate.b_knight;
-
-    U64 northwest, southwest, northeast, southeast;
-    U64 north, south, east, west;
-    U64 most_significant_bit, difference, target_squares = 0;
-
-    while (whiteBishops) {
-        target_squares = 0;
-        int bishop = popLSB(whiteBishops);
-
-        northwest = gamestate.all_pieces & MovementTables::bishopMoves[bishop][0];
-        southeast = gamestate.all_pieces & MovementTables::bishopMoves[bishop][2];
-        northeast = gamestate.all_pieces & MovementTables::bishopMoves[bishop][1];
-        southwest = gamestate.all_pieces & MovementTables::bishopMoves[bishop][3];
-
-        most_significant_bit = getMSB(southeast);
-        difference = northwest ^ (northwest - most_significant_bit);
-        target_squares |= difference & MovementTables::bishopMoves[bishop][4] & ~gamestate.w_pieces;
-
-        most_significant_bit = getMSB(southwest);
-        difference = northeast ^ (northeast - most_significant_bit);
-        target_squares |= difference & MovementTables::bishopMoves[bishop][5] & ~gamestate.w_pieces;
-
-        whiteCount += bit_cnt(target_squares);
-    }
-
-    while (blackBishops) {
-        target_squares = 0;
-        int bishop = popLSB(blackBishops);
-
-        northwest = gamestate.all_pieces & MovementTables::bishopMoves[bishop][0];
-        southeast = gamestate.all_pieces & MovementTables::bishopMoves[bishop][2];
-        northeast = gamestate.all_pieces & MovementTables::bishopMoves[bishop][1];
-        southwest = gamestate.all_pieces & MovementTables::bishopMoves[bishop][3];
-
-        most_significant_bit = getMSB(southeast);
-        difference = northwest ^ (northwest - most_significant_bit);
-        target_squares |= difference & MovementTables::bishopMoves[bishop][4] & ~gamestate.b_pieces;
-
-        most_significant_bit = getMSB(southwest);
-        difference = northeast ^ (northeast - most_significant_bit);
-        target_squares |= difference & MovementTables::bishopMoves[bishop][5] & ~gamestate.b_pieces;
-
-        blackCount += bit_cnt(target_squares);
-    }
-
-    while(whiteRooks) {
-        target_squares = 0;
-        int rook = popLSB(whiteRooks);
-
-        north = gamestate.all_pieces & MovementTables::rookMoves[rook][0];
-        south = gamestate.all_pieces & MovementTables::rookMoves[rook][2];
-        east = gamestate.all_pieces & MovementTables::rookMoves[rook][1];
-        west = gamestate.all_pieces & MovementTables::rookMoves[rook][3];
-
-        most_significant_bit = getMSB(south);
-        difference = north ^ (north - most_significant_bit);
-        target_squares |= difference & MovementTables::rookMoves[rook][4] & ~gamestate.w_pieces;
-
-        most_significant_bit = getMSB(west);
-        difference = east ^ (east - most_significant_bit);
-        target_squares |= difference & MovementTables::rookMoves[rook][5] & ~gamestate.w_pieces;
-
-        whiteCount += bit_cnt(target_squares);
-    }
-
-    while(blackRooks) {
-        target_squares = 0;
-        int rook = popLSB(blackRooks);
-
-        north = gamestate.all_pieces & MovementTables::rookMoves[rook][0];
-        south = gamestate.all_pieces & MovementTables::rookMoves[rook][2];
-        east = gamestate.all_pieces & MovementTables::rookMoves[rook][1];
-        west = gamestate.all_pieces & MovementTables::rookMoves[rook][3];
-
-        most_significant_bit = getMSB(south);
-        difference = north ^ (north - most_significant_bit);
-        target_squares |= difference & MovementTables::rookMoves[rook][4] & ~gamestate.b_pieces;
-
-        most_significant_bit = getMSB(west);
-        difference = east ^ (east - most_significant_bit);
-        target_squares |= difference & MovementTables::rookMoves[rook][5] & ~gamestate.b_pieces;
-
-        blackCount += bit_cnt(target_squares);
-    }
-
-    while (whiteKnights) {
-        whiteCount += bit_cnt(MovementTables::knightMoves[popLSB(whiteKnights)] & ~gamestate.w_pieces);
-    }
+void MoveGenerator::CalculateAttackMaps() {
+    const Gamestate& gamestate = Gamestate::Get();
 
-    while (blackKnights) {
-        blackCount += bit_cnt(MovementTables::knightMoves[popLSB(blackKnights)] & ~gamestate.b_pieces);
+    // The enemy's half comes from move generation, which has often run in this position already
+    if (enemyAttacksKey != gamestate.zobristKey) CalculateEnemyAttacks();
+
+    int color = gamestate.whiteToMove ? 0 : 1;
+    int offset = 6 * color;
+    U64 ownPieces = gamestate.whiteToMove ? gamestate.w_pieces : gamestate.b_pieces;
+
+    attacksBy[offset] = PawnMoves::allCaptures(gamestate.whiteToMove, *gamestate.bitboards[offset]);
+    attacksBy[offset + 5] = MovementTables::kingMoves[squareOf(*gamestate.bitboards[offset + 5])];
+
+    U64 mobilityArea = ~ownPieces & ~attacksBy[6 - offset];
+    mobility[color] = 0;
+
+    for (int piece = offset + 1; piece <= offset + 4; ++piece) {
+        U64 pieces = *gamestate.bitboards[piece];
+        attacksBy[piece] = 0;
+
+        while (pieces) {
+            int square = popLSB(pieces);
+            U64 targets;
+
+            switch (piece - offset) {
+                case 1:
+                    targets = MovementTables::knightMoves[square];
+                    break;
+                case 2:
+                    targets = BishopAttacks(square, gamestate.all_pieces);
+                    break;
+                case 3:
+                    targets = RookAttacks(square, gamestate.all_pieces);
+                    break;
+                default:
+                    targets = BishopAttacks(square, gamestate.all_pieces) | RookAttacks(square, gamestate.all_pieces);
+                    break;
+            }
+            attacksBy[piece] |= targets;
+            mobility[color] += bit_cnt(targets & mobilityArea);
+        }
     }
 
-    return (whiteCount + 1) / (blackCount + 1);
+    attacks[color] = 0;
+    for (int piece = offset; piece < offset + 6; ++piece) attacks[color] |= attacksBy[piece];
 }
 
 void MoveGenerator::CalculateEnemyAttacks() {
     const Gamestate& gamestate = Gamestate::Get();
-
-    U64 friendlyPieces, kingPos, orthogonalSliders, diagonalSliders, enemyKnights, allPieces,
-            north, south, east, west, northeast, northwest, southeast, southwest, mostSignificantBit, difference;
-    int slider;
-
-    if (gamestate.whiteToMove) {
-        enemyAttacks = (*gamestate.bitboards[6] & ~Board::Files::hFile) >> 7 | (*gamestate.bitboards[6] & ~Board::Files::aFile) >> 9;
-        friendlyPieces = gamestate.w_pieces;
-        kingPos = gamestate.w_king;
-    } else {
-        enemyAttacks = (*gamestate.bitboards[0] & ~Board::Files::aFile) << 7 | (*gamestate.bitboards[0] & ~Board::Files::hFile) << 9;
-        friendlyPieces = gamestate.b_pieces;
-        kingPos = gamestate.b_king;
-    }
-
-    allPieces = gamestate.all_pieces ^ kingPos;
-    enemyKnights = (*gamestate.bitboards[1] | *gamestate.bitboards[7]) & ~friendlyPieces;
-    diagonalSliders = (*gamestate.bitboards[2] | *gamestate.bitboards[4] | *gamestate.bitboards[8] | *gamestate.bitboards[10]) & ~friendlyPieces;
-    orthogonalSliders =(*gamestate.bitboards[3] | *gamestate.bitboards[4] | *gamestate.bitboards[9] | *gamestate.bitboards[10]) & ~friendlyPieces;
-
-    while (enemyKnights) enemyAttacks |= MovementTables::knightMoves[popLSB(enemyKnights)];
-    while (diagonalSliders) {
-        slider = popLSB(diagonalSliders);
-
+    enemyAttacksKey = gamestate.zobristKey;
+
+    // The enemy's maps are kept by piece as well, for the evaluation. Sliders see through our king,
+    // so the king can't step back along a check, but the evaluation's maps stop at it.
+    int color = gamestate.whiteToMove ? 1 : 0;
+    int offset = 6 * color;
+    U64 friendlyPieces = gamestate.whiteToMove ? gamestate.w_pieces : gamestate.b_pieces;
+    U64 kingPos = *gamestate.bitboards[6 - offset + 5];
+    U64 allPieces = gamestate.all_pieces ^ kingPos;
+    U64 north, south, east, west, northeast, northwest, southeast, southwest, mostSignificantBit, difference;
+
+    auto diagonalAttacks = [&](int slider) {
         northwest = allPieces & MovementTables::bishopMoves[slider][0];
         southeast = allPieces & MovementTables::bishopMoves[slider][2];
         northeast = allPieces & MovementTables::bishopMoves[slider][1];
@@ -264,15 +198,13 @@ void MoveGenerator::CalculateEnemyAttacks() {
 
         mostSignificantBit = getMSB(southeast);
         difference = northwest ^ (northwest - mostSignificantBit);
-        enemyAttacks |= difference & MovementTables::bishopMoves[slider][4];
+        U64 targets = difference & MovementTables::bishopMoves[slider][4];
 
         mostSignificantBit = getMSB(southwest);
         difference = northeast ^ (northeast - mostSignificantBit);
-        enemyAttacks |= difference & MovementTables::bishopMoves[slider][5];
-    }
-    while (orthogonalSliders) {
-        slider = popLSB(orthogonalSliders);
-
+        return targets | (difference & MovementTables::bishopMoves[slider][5]);
+    };
+    auto orthogonalAttacks = [&](int slider) {
         north = allPieces & MovementTables::rookMoves[slider][0];
         south = allPieces & MovementTables::rookMoves[slider][2];
         east = allPieces & MovementTables::rookMoves[slider][1];
@@ -280,13 +212,61 @@ void MoveGenerator::CalculateEnemyAttacks() {
 
         mostSignificantBit = getMSB(south);
         difference = north ^ (north - mostSignificantBit);
-        enemyAttacks |= difference & MovementTables::rookMoves[slider][4];
+        U64 targets = difference & MovementTables::rookMoves[slider][4];
 
         mostSignificantBit = getMSB(west);
         difference = east ^ (east - mostSignificantBit);
-        enemyAttacks |= difference & MovementTables::rookMoves[slider][5];
+        return targets | (difference & MovementTables::rookMoves[slider][5]);
+    };
+
+    if (gamestate.whiteToMove) {
+        attacksBy[6] = (*gamestate.bitboards[6] & ~Board::Files::hFile) >> 7 | (*gamestate.bitboards[6] & ~Board::Files::aFile) >> 9;
+    } else {
+        attacksBy[0] = (*gamestate.bitboards[0] & ~Board::Files::aFile) << 7 | (*gamestate.bitboards[0] & ~Board::Files::hFile) << 9;
+    }
+    U64 mobilityArea = ~(gamestate.all_pieces & ~friendlyPieces) &
+                       ~PawnMoves::allCaptures(gamestate.whiteToMove, *gamestate.bitboards[6 - offset]);
+    mobility[color] = 0;
+    enemyAttacks = 0;
+
+    for (int piece = offset + 1; piece <= offset + 4; ++piece) {
+        U64 pieces = *gamestate.bitboards[piece];
+        attacksBy[piece] = 0;
+
+        while (pieces) {
+            int slider = popLSB(pieces);
+            U64 targets;
+
+            switch (piece - offset) {
+                case 1:
+                    targets = MovementTables::knightMoves[slider];
+                    break;
+                case 2:
+                    targets = diagonalAttacks(slider);
+                    break;
+                case 3:
+                    targets = orthogonalAttacks(slider);
+                    break;
+                default:
+                    targets = diagonalAttacks(slider) | orthogonalAttacks(slider);
+                    break;
+            }
+            enemyAttacks |= targets;
+
+            if (targets & kingPos && piece - offset != 1) {
+                targets = piece - offset == 2 ? BishopAttacks(slider, gamestate.all_pieces)
+                        : piece - offset == 3 ? RookAttacks(slider, gamestate.all_pieces)
+                        : BishopAttacks(slider, gamestate.all_pieces) | RookAttacks(slider, gamestate.all_pieces);
+            }
+            attacksBy[piece] |= targets;
+            mobility[color] += bit_cnt(targets & mobilityArea);
+        }
     }
-    enemyAttacks |= MovementTables::kingMoves[squareOf(~friendlyPieces & (*gamestate.bitboards[5] | *gamestate.bitboards[11]))];
+    attacksBy[offset + 5] = MovementTables::kingMoves[squareOf(*gamestate.bitboards[offset + 5])];
+    enemyAttacks |= attacksBy[offset] | attacksBy[offset + 5];
+
+    attacks[color] = 0;
+    for (int piece = offset; piece < offset + 6; ++piece) attacks[color] |= attacksBy[piece];
 }
 
 void MoveGenerator::CalculateCheckMask() {
@@ -733,16 +713,16 @@ void MoveGenerator::GenerateRookMoves() {
     }
 }
 
-int MoveGenerator::PerftTree(int depthPly) {
+U64 MoveGenerator::PerftTree(int depthPly) {
     Gamestate& gamestate = Gamestate::Get();
 
     if (depthPly == 1) {
         std::vector<Move> legalMoves = GenerateLegalMoves();
-        return static_cast<int>(legalMoves.size());
+        return legalMoves.size();
     }
 
     std::vector<Move> legalMoves = GenerateLegalMoves();
-    int nodesFound = 0;
+    U64 nodesFound = 0;
     for (auto move : legalMoves) {
         gamestate.MakeMove(move);
         nodesFound += PerftTree(depthPly - 1);
@@ -750,3 +730,64 @@ int MoveGenerator::PerftTree(int depthPly) {
     }
     return nodesFound;
 }
+
+U64 MoveGenerator::HashedPerft(int depthPly) {
+    Gamestate& gamestate = Gamestate::Get();
+
+    if (depthPly == 1) return GenerateLegalMoves().size();
+
+    PerftTable& table = PerftTable::Get();
+    U64 nodesFound = 0;
+    if (table.Probe(gamestate.zobristKey, depthPly, nodesFound)) return nodesFound;
+
+    std::vector<Move> legalMoves = GenerateLegalMoves();
+    for (auto move : legalMoves) {
+        gamestate.MakeMove(move);
+        nodesFound += HashedPerft(depthPly - 1);
+        gamestate.UndoMove();
+    }
+    table.Store(gamestate.zobristKey, depthPly, nodesFound);
+    return nodesFound;
+}
+
+U64 MoveGenerator::ParallelPerft(int depthPly, int threads, bool hashed) {
+    Gamestate& gamestate = Gamestate::Get();
+    if (threads <= 0) threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    if (threads == 1 || depthPly < 3) return hashed ? HashedPerft(depthPly) : PerftTree(depthPly);
+
+    // Root moves alone are too few and too uneven to share out, their replies make the work items
+    std::vector<std::pair<Move, Move>> subtrees;
+    for (Move move : GenerateLegalMoves()) {
+        gamestate.MakeMove(move);
+        for (Move reply : GenerateLegalMoves()) subtrees.emplace_back(move, reply);
+        gamestate.UndoMove();
+    }
+
+    const std::string& position = gamestate.startingPosition;
+    const std::vector<Move> history = gamestate.MoveHistory();
+    std::atomic<size_t> nextSubtree = 0;
+    std::atomic<U64> nodesFound = 0;
+
+    std::vector<std::thread> workers;
+    for (int thread = 0; thread < threads; ++thread) {
+        workers.emplace_back([&] {
+            // Each thread has its own position, brought to this one by replaying the game
+            Gamestate& copy = Gamestate::Get();
+            copy.Seed(position);
+            for (Move move : history) copy.MakeMove(move);
+
+            U64 found = 0;
+            for (size_t i = nextSubtree++; i < subtrees.size(); i = nextSubtree++) {
+                copy.MakeMove(subtrees[i].first);
+                copy.MakeMove(subtrees[i].second);
+                MoveGenerator& generator = MoveGenerator::Get();
+                found += hashed ? generator.HashedPerft(depthPly - 2) : generator.PerftTree(depthPly - 2);
+                copy.UndoMove();
+                copy.UndoMove();
+            }
+            nodesFound += found;
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+    return nodesFound;
+}
@@ -244,12 +244,32 @@ namespace MovementTables {
     inline U64 kingMoves[64];
 }
 
+inline U64 BishopAttacks(int square, U64 occupancy) {
+    U64 northwest = occupancy & MovementTables::bishopMoves[square][0];
+    U64 northeast = occupancy & MovementTables::bishopMoves[square][1];
+    U64 southeast = occupancy & MovementTables::bishopMoves[square][2];
+    U64 southwest = occupancy & MovementTables::bishopMoves[square][3];
+
+    return ((northwest ^ (northwest - getMSB(southeast))) & MovementTables::bishopMoves[square][4]) |
+           ((northeast ^ (northeast - getMSB(southwest))) & MovementTables::bishopMoves[square][5]);
+}
+
+inline U64 RookAttacks(int square, U64 occupancy) {
+    U64 north = occupancy & MovementTables::rookMoves[square][0];
+    U64 east = occupancy & MovementTables::rookMoves[square][1];
+    U64 south = occupancy & MovementTables::rookMoves[square][2];
+    U64 west = occupancy & MovementTables::rookMoves[square][3];
+
+    return ((north ^ (north - getMSB(south))) & MovementTables::rookMoves[square][4]) |
+           ((east ^ (east - getMSB(west))) & MovementTables::rookMoves[square][5]);
+}
+
 class MoveGenerator {
 private:
     MoveGenerator();
 public:
     static MoveGenerator& Get() {
-        static MoveGenerator instance;
+        static thread_local MoveGenerator instance;
         return instance;
     }
 
@@ -262,11 +282,21 @@ public:
 
     std::vector<Move> legalMoves;
 
+    // Squares attacked by each piece type, indexed like Gamestate::bitboards
+    std::array<U64, 12> attacksBy;
+    std::array<U64, 2> attacks;   // everything white, then black, attacks
+    std::array<int, 2> mobility;  // moves to squares that are neither ours nor guarded by an enemy pawn
+    U64 enemyAttacksKey = 0;      // the position the enemy's half of the maps and enemyAttacks were made for
+
     std::vector<Move> GenerateLegalMoves(bool capturesOnly = false);
-    float CountLegalMoves();
-    int PerftTree(int depthPly);
+    U64 PerftTree(int depthPly);
+    // Counts each subtree once per transposition, looking the others up in the PerftTable
+    U64 HashedPerft(int depthPly);
+    // Splits the tree two plies down across threads, 0 for one per core
+    U64 ParallelPerft(int depthPly, int threads = 0, bool hashed = false);
 
     void CalculateEnemyAttacks();
+    void CalculateAttackMaps();
     void CalculateCheckMask();
     void CalculatePinMasks();
 